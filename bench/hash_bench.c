@@ -0,0 +1,111 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+// 字符串哈希基准：CMake 分别以 wyhash（hash_bench）与 FNV-1a（hash_bench_fnv1a）构建本文件，
+// 输出不同长度的键的吞吐量（重复 BENCH_RUNS 次，给出最小值、中位数和最大值），以及 10 万个标识符放入驻留表大小的桶中时的冲突数
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hash.h"
+#include "table.h"
+
+#ifdef STRING_HASH_FNV1A
+#define HASH_NAME "fnv1a"
+#else
+#define HASH_NAME "wyhash"
+#endif
+
+// 每种长度大约处理的字节数
+#define BENCH_BYTES ((size_t) 256 << 20)
+// 每种长度重复测量的次数，短键的结果在两次运行之间波动很大，只看一次不可靠
+#define BENCH_RUNS 7
+// 冲突测试的标识符数与桶数
+#define BENCH_IDENTIFIERS 100000
+#define BENCH_BUCKETS 131072
+
+static double now() {
+    struct timespec time;
+    timespec_get(&time, TIME_UTC);
+    return (double) time.tv_sec + (double) time.tv_nsec / 1e9;
+}
+
+// 键的起点在缓冲区前 BENCH_SPAN 字节中滑动，缓冲区再多留出最长键的长度
+#define BENCH_SPAN ((size_t) 1 << 20)
+
+// 哈希长度为 length 的键，返回 GB/s（hashString 在另一个编译单元中，调用不会被优化掉）
+static double throughput(const char *buffer, int length, uint32_t *sink) {
+    size_t count = BENCH_BYTES / (size_t) length;
+    uint32_t hash = 0;
+    double start = now();
+    for (size_t i = 0; i < count; i++) {
+        hash += hashString(buffer + ((i * 61) & (BENCH_SPAN - 1)), length);
+    }
+    double seconds = now() - start;
+    *sink ^= hash;
+    return (double) count * (double) length / seconds / 1e9;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    double x = *(const double *) a;
+    double y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+static int compareHashes(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+    return (x > y) - (x < y);
+}
+
+int main() {
+    // 伪随机内容，足够容纳最长的键
+    size_t bufferSize = BENCH_SPAN + 65536;
+    char *buffer = malloc(bufferSize);
+    if (buffer == NULL) return 1;
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < bufferSize; i++) {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        buffer[i] = (char) ('a' + (state >> 59));
+    }
+
+    uint32_t sink = 0;
+    const int lengths[] = {4, 12, 64, 65536};
+    for (int i = 0; i < (int) (sizeof(lengths) / sizeof(lengths[0])); i++) {
+        double runs[BENCH_RUNS];
+        for (int run = 0; run < BENCH_RUNS; run++) runs[run] = throughput(buffer, lengths[i], &sink);
+        qsort(runs, BENCH_RUNS, sizeof(double), compareDoubles);
+        printf("%s length %5d: min %6.2f  median %6.2f  max %6.2f GB/s\n", HASH_NAME, lengths[i],
+               runs[0], runs[BENCH_RUNS / 2], runs[BENCH_RUNS - 1]);
+    }
+
+    // 标识符 "v0" .. "v99999"：桶号与驻留表一样取哈希值的高位，统计落入已占用桶的键数
+    uint8_t *used = calloc(BENCH_BUCKETS, 1);
+    uint32_t *hashes = malloc(sizeof(uint32_t) * BENCH_IDENTIFIERS);
+    if (used == NULL || hashes == NULL) return 1;
+    int collisions = 0;
+    for (int i = 0; i < BENCH_IDENTIFIERS; i++) {
+        char name[16];
+        int length = snprintf(name, sizeof(name), "v%d", i);
+        uint32_t hash = hashString(name, length);
+        hashes[i] = hash;
+        uint32_t bucket = TABLE_H1(hash) & (BENCH_BUCKETS - 1);
+        if (used[bucket]) collisions++;
+        used[bucket] = 1;
+    }
+    // 完整的 32 位哈希值相同的键
+    qsort(hashes, BENCH_IDENTIFIERS, sizeof(uint32_t), compareHashes);
+    int duplicates = 0;
+    for (int i = 1; i < BENCH_IDENTIFIERS; i++) {
+        if (hashes[i] == hashes[i - 1]) duplicates++;
+    }
+    printf("%s %d identifiers in %d buckets: %d bucket collisions, %d equal hashes\n",
+           HASH_NAME, BENCH_IDENTIFIERS, BENCH_BUCKETS, collisions, duplicates);
+
+    free(hashes);
+    free(used);
+    free(buffer);
+    return sink == 0x12345678u ? 2 : 0;
+}
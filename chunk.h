@@ -75,6 +75,30 @@ typedef enum {
     // 继承
     OP_GET_SUPER,
     OP_SUPER_INVOKE,
+    // 列表：用栈顶的 n 个值创建列表；映射：用栈顶的 n 对键值创建映射；按下标（键）读写
+    OP_BUILD_LIST,
+    OP_BUILD_MAP,
+    OP_INDEX_GET,
+    OP_INDEX_SET,
+    // for (i in a..b)：计数器、终点、循环变量依次位于操作数指定的槽位；
+    // OP_FOR_PREP 检查范围并在为空时向前跳出，OP_FOR_RANGE 在一条指令中递增、比较并跳回循环体
+    OP_FOR_PREP,
+    OP_FOR_RANGE,
+    // for (x in collection)：集合、下标、循环变量依次位于操作数指定的槽位，取出下一个元素并跳回循环体
+    OP_FOR_ITER,
+    // 自增自减：操作数为目标（槽位或名字，下标形式没有）和有符号的增量，原地更新目标并留下原来的值
+    OP_INC_LOCAL,
+    OP_INC_UPVALUE,
+    OP_INC_GLOBAL,
+    OP_INC_PROPERTY,
+    OP_INC_INDEX,
+    // 复合赋值：操作数为目标和运算指令（OP_ADD、OP_SUBTRACT、OP_MULTIPLY、OP_DIVIDE），
+    // 目标只查找一次，与栈顶的右值运算后原地更新并留下新值
+    OP_COMPOUND_LOCAL,
+    OP_COMPOUND_UPVALUE,
+    OP_COMPOUND_GLOBAL,
+    OP_COMPOUND_PROPERTY,
+    OP_COMPOUND_INDEX,
 } OpCode;
 
 // 动态数组
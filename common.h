@@ -8,12 +8,26 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+// 使用 NaN boxing 将 Value 压缩为 8 字节（注释掉则使用带类型标签的结构体）
+#define NAN_BOXING
+// 指针压缩：对象分配在同一块预留的虚拟内存（堆笼）中，对象之间的引用保存为 32 位偏移
+//#define POINTER_COMPRESSION
 // 是否为调试模式
 #define DEBUG_TRACE_EXECUTION
 // 调试打印代码
 #define DEBUG_PRINT_CODE
 // 打印GC调试
 //#define DEBUG_LOG_GC
+// 退出时打印字符串驻留表的探测长度统计（用于比较哈希算法的冲突情况）
+//#define DEBUG_LOG_STRINGS
+// 字符串哈希算法：默认为 wyhash（每次读取 8 字节），打开则使用逐字节的 FNV-1a
+//#define STRING_HASH_FNV1A
+// 列表排序不调用脚本比较函数时，元素数达到该值则分块并行排序再归并
+#define SORT_PARALLEL_THRESHOLD 65536
+// 并行排序的最大线程数
+#define SORT_MAX_THREADS 8
+// JSON 解析与序列化允许的最大嵌套深度（序列化时也用它发现循环引用）
+#define JSON_MAX_DEPTH 512
 #define UINT8_COUNT (UINT8_MAX + 1)
 #define DEBUG_STRESS_GC
 #endif //PANDA_COMMON_H
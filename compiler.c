@@ -26,6 +26,10 @@ typedef struct {
     bool hadError;
     // 代码出现错误，进入panic模式
     bool panicMode;
+    // 持有源码的对象（为 NULL 时源码在编译后可能被释放，需要拷贝字符）
+    Obj *sourceOwner;
+    // 最近一条读取变量、属性或下标的指令的位置，前缀自增自减据此改写出 OP_INC_* 指令
+    int lastGet;
 } Parser;
 // 优先排序，越往下，优先级越高，每个符号代表不止一个优先级
 typedef enum {
@@ -262,6 +266,14 @@ static void patchJump(int offset) {
     currentChunk()->code[offset + 1] = jump & 0xff;
 }
 
+// 根据源码中的字符创建字符串，源码由 GC 对象持有时直接引用，不拷贝
+static ObjString *sourceString(const char *start, int length) {
+    if (parser.sourceOwner != NULL) {
+        return externalString(start, length, parser.sourceOwner);
+    }
+    return copyString(start, length);
+}
+
 // 初始化变量池量+函数编译器，当前的指针指向函数定义后的(
 static void initCompiler(Compiler *compiler, FunctionType type) {
     compiler->enclosing = current;
@@ -274,7 +286,7 @@ static void initCompiler(Compiler *compiler, FunctionType type) {
     current = compiler;
     // 函数名赋值
     if (type != TYPE_SCRIPT) {
-        current->function->name = copyString(parser.previous.start, parser.previous.length);
+        current->function->name = sourceString(parser.previous.start, parser.previous.length);
     }
     Local *local = &current->locals[current->localCount++];
     local->depth = 0;
@@ -298,7 +310,11 @@ static ObjFunction *endCompiler() {
     ObjFunction *function = current->function;
 #ifdef DEBUG_PRINT_CODE
     if (!parser.hadError) {
-        disassembleChunk(currentChunk(), function->name != NULL ? function->name->chars : "<script>");
+        // 函数名可能引用源码，不以 '\0' 结尾
+        char name[UINT8_COUNT];
+        snprintf(name, sizeof(name), "%.*s", function->name != NULL ? function->name->length : 8,
+                 function->name != NULL ? function->name->chars : "<script>");
+        disassembleChunk(currentChunk(), name);
     }
 #endif
     // 当前的指针，指向之前的闭包
@@ -339,7 +355,7 @@ static void parsePrecedence(Precedence precedence);
 
 // 将标识符转为常量，加入到 Value 池中，将变量名加入到池子中
 static uint8_t identifierConstant(Token *name) {
-    return makeConstant(OBJ_VAL(copyString(name->start, name->length)));
+    return makeConstant(OBJ_VAL(sourceString(name->start, name->length)));
 }
 
 // 判断两个标识符是否相等
@@ -551,6 +567,34 @@ static void call(bool canAssign) {
     emitBytes(OP_CALL, argCount);
 }
 
+// 匹配复合赋值运算符，返回对应的算术指令，不是复合赋值运算符时返回 -1
+static int matchCompoundOperator() {
+    if (match(TOKEN_PLUS_EQUAL)) return OP_ADD;
+    if (match(TOKEN_MINUS_EQUAL)) return OP_SUBTRACT;
+    if (match(TOKEN_STAR_EQUAL)) return OP_MULTIPLY;
+    if (match(TOKEN_SLASH_EQUAL)) return OP_DIVIDE;
+    return -1;
+}
+
+// 变量、属性或下标之后的后缀自增自减与复合赋值，发出只查找一次目标、原地更新的融合指令
+// 后缀自增自减留下原来的值，最后一个字节是增量；复合赋值留下新值，最后一个字节是运算指令
+// 下标形式的指令没有目标操作数，arg 为 -1
+static bool updateTarget(bool canAssign, OpCode incOp, OpCode compoundOp, int arg) {
+    if (match(TOKEN_PLUS_PLUS) || match(TOKEN_MINUS_MINUS)) {
+        emitByte(incOp);
+        if (arg != -1) emitByte((uint8_t) arg);
+        emitByte((uint8_t) (parser.previous.type == TOKEN_PLUS_PLUS ? 1 : -1));
+        return true;
+    }
+    int op;
+    if (!canAssign || (op = matchCompoundOperator()) == -1) return false;
+    expression();
+    emitByte(compoundOp);
+    if (arg != -1) emitByte((uint8_t) arg);
+    emitByte((uint8_t) op);
+    return true;
+}
+
 static void dot(bool canAssign) {
     consume(TOKEN_IDENTIFIER, "Expect property name after '.'(未得到标识符: .).");
     uint8_t name = identifierConstant(&parser.previous);
@@ -565,12 +609,62 @@ static void dot(bool canAssign) {
         emitBytes(OP_INVOKE, name);
         emitByte(argCount);
     }
-        // 获取属性
-    else {
+        // 自增自减、复合赋值，否则获取属性
+    else if (!updateTarget(canAssign, OP_INC_PROPERTY, OP_COMPOUND_PROPERTY, name)) {
+        parser.lastGet = currentChunk()->count;
         emitBytes(OP_GET_PROPERTY, name);
     }
 }
 
+// 列表字面量 [a, b, c]：元素依次入栈，再由 OP_BUILD_LIST 收集
+static void list(bool canAssign) {
+    int count = 0;
+    if (!check(TOKEN_RIGHT_BRACKET)) {
+        do {
+            if (check(TOKEN_RIGHT_BRACKET)) break; // 允许末尾的逗号
+            expression();
+            if (count == 255) {
+                error("Can't have more than 255 elements in a list literal.");
+            }
+            count++;
+        } while (match(TOKEN_COMMA));
+    }
+    consume(TOKEN_RIGHT_BRACKET, "Expect ']' after list elements.");
+    emitBytes(OP_BUILD_LIST, (uint8_t) count);
+}
+
+// 映射字面量 {k: v, ...}：键值依次入栈，再由 OP_BUILD_MAP 收集（语句开头的 { 仍然是代码块）
+static void map(bool canAssign) {
+    int count = 0;
+    if (!check(TOKEN_RIGHT_BRACE)) {
+        do {
+            if (check(TOKEN_RIGHT_BRACE)) break; // 允许末尾的逗号
+            expression();
+            consume(TOKEN_COLON, "Expect ':' after map key.");
+            expression();
+            if (count == 255) {
+                error("Can't have more than 255 entries in a map literal.");
+            }
+            count++;
+        } while (match(TOKEN_COMMA));
+    }
+    consume(TOKEN_RIGHT_BRACE, "Expect '}' after map entries.");
+    emitBytes(OP_BUILD_MAP, (uint8_t) count);
+}
+
+// 下标 a[i] 与下标赋值 a[i] = v
+static void subscript(bool canAssign) {
+    expression();
+    consume(TOKEN_RIGHT_BRACKET, "Expect ']' after index.");
+    if (canAssign && match(TOKEN_EQUAL)) {
+        expression();
+        emitByte(OP_INDEX_SET);
+    } else if (!updateTarget(canAssign, OP_INC_INDEX, OP_COMPOUND_INDEX, -1)) {
+        parser.lastGet = currentChunk()->count;
+        emitByte(OP_INDEX_GET);
+    }
+}
+
 // 将预设值加入到 chunk 中
 static void literal(bool canAssign) {
     switch (parser.previous.type) {
@@ -599,6 +693,11 @@ static void grouping(bool canAssign) {
 static void number(bool canAssign) {
     // 字符串转数字
     double value = strtod(parser.previous.start, NULL);
+    // 没有小数点且能放进 int32 的字面量作为小整数
+    if (memchr(parser.previous.start, '.', parser.previous.length) == NULL && value <= INT32_MAX) {
+        emitConstant(INT_VAL((int32_t) value));
+        return;
+    }
     // 将OP_CONSTANT放入 chunk 中，并将 value 放入常量池中
     emitConstant(NUMBER_VAL(value));
 }
@@ -619,37 +718,47 @@ static void or_(bool canAssign) {
 
 // 将字符串加入到 chunk 的常量池中
 static void string(bool canAssign) {
-    emitConstant(OBJ_VAL(copyString(parser.previous.start + 1, parser.previous.length - 2)));
+    emitConstant(OBJ_VAL(sourceString(parser.previous.start + 1, parser.previous.length - 2)));
 }
 
 // 传入 token 表示变量名，查找是否有该变量
-static void namedVariable(Token name, bool canAssign) {
-    uint8_t getOp, setOp;
+// assignable 为 false 时（this、super 与编译器生成的名字）不能作为赋值、自增自减的目标
+static void namedVariable(Token name, bool canAssign, bool assignable) {
+    uint8_t getOp, setOp, incOp, compoundOp;
     // 查看当前是否有当前命名的变量，返回为 -1 则表示没有
     int arg = resolveLocal(current, &name);
     // 没有该变量，表明该变量为
     if (arg != -1) {
         getOp = OP_GET_LOCAL;
         setOp = OP_SET_LOCAL;
+        incOp = OP_INC_LOCAL;
+        compoundOp = OP_COMPOUND_LOCAL;
     } else if ((arg = resolveUpvalue(current, &name)) != -1) {
         getOp = OP_GET_UPVALUE;
         setOp = OP_SET_UPVALUE;
+        incOp = OP_INC_UPVALUE;
+        compoundOp = OP_COMPOUND_UPVALUE;
     } else {
         arg = identifierConstant(&name);
         getOp = OP_GET_GLOBAL;
         setOp = OP_SET_GLOBAL;
+        incOp = OP_INC_GLOBAL;
+        compoundOp = OP_COMPOUND_GLOBAL;
     }
-    if (canAssign && match(TOKEN_EQUAL)) {
+    if (!assignable) {
+        emitBytes(getOp, (uint8_t) arg);
+    } else if (canAssign && match(TOKEN_EQUAL)) {
         expression();
         emitBytes(setOp, (uint8_t) arg);
-    } else {
+    } else if (!updateTarget(canAssign, incOp, compoundOp, arg)) {
+        parser.lastGet = currentChunk()->count;
         emitBytes(getOp, (uint8_t) arg);
     }
 }
 
 
 static void variable(bool canAssign) {
-    namedVariable(parser.previous, canAssign);
+    namedVariable(parser.previous, canAssign, true);
 }
 
 static Token syntheticToken(const char *text) {
@@ -668,14 +777,14 @@ static void super_(bool canAssign) {
     consume(TOKEN_DOT, "Expect '.' after 'super'.");
     consume(TOKEN_IDENTIFIER, "Expect superclass method name.");
     uint8_t name = identifierConstant(&parser.previous);
-    namedVariable(syntheticToken("this"), false);
+    namedVariable(syntheticToken("this"), false, false);
     if (match(TOKEN_LEFT_PAREN)) {
         uint8_t argCount = argumentList();
-        namedVariable(syntheticToken("super"), false);
+        namedVariable(syntheticToken("super"), false, false);
         emitBytes(OP_SUPER_INVOKE, name);
         emitByte(argCount);
     } else {
-        namedVariable(syntheticToken("super"), false);
+        namedVariable(syntheticToken("super"), false, false);
         emitBytes(OP_GET_SUPER, name);
     }
 }
@@ -685,7 +794,7 @@ static void this_(bool canAssign) {
         error("Can't use 'this' outside of a class.(不能在类外使用 this)");
         return;
     }
-    variable(false);
+    namedVariable(parser.previous, false, false);
 }
 
 // 一元表达式解析
@@ -709,6 +818,45 @@ static void unary(bool canAssign) {
     }
 }
 
+// 前缀自增自减：编译操作数后把最后一条读取指令改写为对应的 OP_INC_* 指令，
+// 它留下原来的值，再加上增量得到新值
+static void prefixIncrement(bool canAssign) {
+    int8_t delta = parser.previous.type == TOKEN_PLUS_PLUS ? 1 : -1;
+    parser.lastGet = -1;
+    parsePrecedence(PREC_UNARY);
+
+    Chunk *chunk = currentChunk();
+    int get = parser.lastGet;
+    int length = get == -1 || chunk->code[get] == OP_INDEX_GET ? 1 : 2;
+    if (get == -1 || get + length != chunk->count) {
+        error("Invalid assignment target.");
+        return;
+    }
+    uint8_t op = chunk->code[get];
+    uint8_t arg = length == 2 ? chunk->code[get + 1] : 0;
+    chunk->count = get;
+    switch (op) {
+        case OP_GET_LOCAL:
+            emitBytes(OP_INC_LOCAL, arg);
+            break;
+        case OP_GET_UPVALUE:
+            emitBytes(OP_INC_UPVALUE, arg);
+            break;
+        case OP_GET_GLOBAL:
+            emitBytes(OP_INC_GLOBAL, arg);
+            break;
+        case OP_GET_PROPERTY:
+            emitBytes(OP_INC_PROPERTY, arg);
+            break;
+        default:
+            emitByte(OP_INC_INDEX);
+            break;
+    }
+    emitByte((uint8_t) delta);
+    emitConstant(INT_VAL(delta));
+    emitByte(OP_ADD);
+}
+
 
 // 转换规则
 ParseRule rules[] = {
@@ -717,12 +865,18 @@ ParseRule rules[] = {
         // )
         [TOKEN_RIGHT_PAREN]   = {NULL, NULL, PREC_NONE},
         // {}
-        [TOKEN_LEFT_BRACE]    = {NULL, NULL, PREC_NONE},
+        [TOKEN_LEFT_BRACE]    = {map, NULL, PREC_NONE},
         [TOKEN_RIGHT_BRACE]   = {NULL, NULL, PREC_NONE},
+        // []
+        [TOKEN_LEFT_BRACKET]  = {list, subscript, PREC_CALL},
+        [TOKEN_RIGHT_BRACKET] = {NULL, NULL, PREC_NONE},
         // ,
         [TOKEN_COMMA]         = {NULL, NULL, PREC_NONE},
         // .
         [TOKEN_DOT]           = {NULL, dot, PREC_CALL},
+        // :
+        [TOKEN_DOT_DOT]       = {NULL, NULL, PREC_NONE},
+        [TOKEN_COLON]         = {NULL, NULL, PREC_NONE},
         // -
         [TOKEN_MINUS]         = {unary, binary, PREC_TERM},
         // +
@@ -749,6 +903,14 @@ ParseRule rules[] = {
         [TOKEN_LESS]          = {NULL, binary, PREC_COMPARISON},
         // <=
         [TOKEN_LESS_EQUAL]    = {NULL, binary, PREC_COMPARISON},
+        // += -= *= /=
+        [TOKEN_PLUS_EQUAL]    = {NULL, NULL, PREC_NONE},
+        [TOKEN_MINUS_EQUAL]   = {NULL, NULL, PREC_NONE},
+        [TOKEN_STAR_EQUAL]    = {NULL, NULL, PREC_NONE},
+        [TOKEN_SLASH_EQUAL]   = {NULL, NULL, PREC_NONE},
+        // ++ --
+        [TOKEN_PLUS_PLUS]     = {prefixIncrement, NULL, PREC_NONE},
+        [TOKEN_MINUS_MINUS]   = {prefixIncrement, NULL, PREC_NONE},
         // 变量
         [TOKEN_IDENTIFIER]    = {variable, NULL, PREC_NONE},
         // 字符串
@@ -771,6 +933,7 @@ ParseRule rules[] = {
         [TOKEN_FOR]           = {NULL, NULL, PREC_NONE},
         [TOKEN_FUN]           = {NULL, NULL, PREC_NONE},
         [TOKEN_IF]            = {NULL, NULL, PREC_NONE},
+        [TOKEN_IN]            = {NULL, NULL, PREC_NONE},
         [TOKEN_PRINT]         = {NULL, NULL, PREC_NONE},
         [TOKEN_RETURN]        = {NULL, NULL, PREC_NONE},
         [TOKEN_VAR]           = {NULL, NULL, PREC_NONE},
@@ -798,7 +961,9 @@ static void parsePrecedence(Precedence precedence) {
         ParseFn infixRule = getRule(parser.previous.type)->infix;
         infixRule(canAssign);
     }
-    if (canAssign && match(TOKEN_EQUAL)) {
+    // 能作为目标的表达式已经消耗了后面的 ++ 与 --，剩下的都跟在不能赋值的表达式之后
+    if ((canAssign && (match(TOKEN_EQUAL) || matchCompoundOperator() != -1)) ||
+        match(TOKEN_PLUS_PLUS) || match(TOKEN_MINUS_MINUS)) {
         error("Invalid assignment target.");
     }
 }
@@ -905,7 +1070,7 @@ static void classDeclaration() {
     // 如果有继承关系，则：
     if (match(TOKEN_LESS)) {
         consume(TOKEN_IDENTIFIER, "Expect superclass name.(缺少父类名)");
-        variable(false);
+        namedVariable(parser.previous, false, false);
         // 类不能继承自己
         if (identifiersEqual(&className, &parser.previous)) {
             error("A class can't inherit from itself.（类不能继承自己）");
@@ -917,7 +1082,7 @@ static void classDeclaration() {
         //
         defineVariable(0);
         // 查找是否有该变量
-        namedVariable(className, false);
+        namedVariable(className, false, false);
         //
         emitByte(OP_INHERIT);
         //
@@ -925,7 +1090,7 @@ static void classDeclaration() {
     }
 
     //
-    namedVariable(className, false);
+    namedVariable(className, false, false);
     consume(TOKEN_LEFT_BRACE, "Expect '{' before class body.（类定义缺少 { ）");
     // 循环读取方法
     while (!check(TOKEN_RIGHT_BRACE) && !check(TOKEN_EOF)) {
@@ -971,11 +1136,76 @@ static void expressionStatement() {
 }
 
 
+// 加入编译器生成的局部变量（名称不是合法的标识符，脚本无法访问），值已经在栈上
+static void addHiddenLocal(const char *name) {
+    addLocal(syntheticToken(name));
+    markInitialized();
+}
+
+// 带槽位操作数的向后跳转，跳回 loopStart
+static void emitForLoop(uint8_t instruction, uint8_t slot, int loopStart) {
+    emitBytes(instruction, slot);
+    int offset = currentChunk()->count - loopStart + 2;
+    if (offset > UINT16_MAX) error("Loop body too large.（循环体过大）");
+    emitByte((offset >> 8) & 0xff);
+    emitByte(offset & 0xff);
+}
+
+// for (name in a..b) 与 for (name in collection)，已经位于 forStatement 开始的作用域中
+// 循环变量每次迭代由循环指令赋值，修改它不影响迭代
+static void forInStatement() {
+    advance();
+    Token name = parser.previous;
+    consume(TOKEN_IN, "Expect 'in' after loop variable.");
+    uint8_t slot = (uint8_t) current->localCount;
+    expression();
+
+    if (match(TOKEN_DOT_DOT)) {
+        // 范围 [a, b)，终点只求值一次
+        expression();
+        consume(TOKEN_RIGHT_PAREN, "Expect ')' after for clauses.（for 循环缺少反括号）");
+        emitByte(OP_NIL);
+        addHiddenLocal("(range counter)");
+        addHiddenLocal("(range end)");
+        addLocal(name);
+        markInitialized();
+
+        emitBytes(OP_FOR_PREP, slot);
+        emitByte(0xff);
+        emitByte(0xff);
+        int exitJump = currentChunk()->count - 2;
+        int bodyStart = currentChunk()->count;
+        statement();
+        emitForLoop(OP_FOR_RANGE, slot, bodyStart);
+        patchJump(exitJump);
+    } else {
+        consume(TOKEN_RIGHT_PAREN, "Expect ')' after for clauses.（for 循环缺少反括号）");
+        emitConstant(INT_VAL(0));
+        emitByte(OP_NIL);
+        addHiddenLocal("(sequence)");
+        addHiddenLocal("(index)");
+        addLocal(name);
+        markInitialized();
+
+        // 先跳到循环末尾取第一个元素，之后每次迭代只执行一条 OP_FOR_ITER
+        int firstJump = emitJump(OP_JUMP);
+        int bodyStart = currentChunk()->count;
+        statement();
+        patchJump(firstJump);
+        emitForLoop(OP_FOR_ITER, slot, bodyStart);
+    }
+    endScope();
+}
+
 static void forStatement() {
     // 开始代码块
     beginScope();
 
     consume(TOKEN_LEFT_PAREN, "Expect '(' after 'for'.（for 缺少正括号）");
+    if (check(TOKEN_IDENTIFIER) && peekToken().type == TOKEN_IN) {
+        forInStatement();
+        return;
+    }
     // 解析定义部分
     // 判断是否匹配到分号
     if (match(TOKEN_SEMICOLON)) {
@@ -1175,9 +1405,11 @@ static void statement() {
 }
 
 // 将文件转为chunk
-ObjFunction *compile(const char *source) {
+ObjFunction *compile(const char *source, Obj *owner) {
     // 初始化扫描仪
     initScanner(source);
+    // 编译期间持有源码的对象作为 GC 根
+    parser.sourceOwner = owner;
     // 定义一个编译器（内有变量池）
     Compiler compiler;
     // 初始化编译器
@@ -1195,11 +1427,14 @@ ObjFunction *compile(const char *source) {
         declaration();
     }
     ObjFunction *function = endCompiler();
+    // 编译结束后，源码由引用它的字符串保持存活
+    parser.sourceOwner = NULL;
     return parser.hadError ? NULL : function;
 }
 
 // 遍历编译链，链中所有闭包均需要编译，链顶表示当前的闭包，逐步往下
 void markCompilerRoots() {
+    markObject(parser.sourceOwner);
     Compiler *compiler = current;
     while (compiler != NULL) {
         markObject((Obj *) compiler->function);
@@ -8,7 +8,8 @@
 #include "object.h"
 #include "vm.h"
 
-ObjFunction *compile(const char *source);
+// owner 为持有源码的对象，不为 NULL 时字面量和标识符直接引用源码中的字符，为 NULL 时拷贝
+ObjFunction *compile(const char *source, Obj *owner);
 
 void markCompilerRoots();
 
@@ -96,6 +96,43 @@ static int jumpInstruction(const char *name, int sign, Chunk *chunk, int offset)
     return offset + 3;
 }
 
+// for-in 循环指令：槽位与跳转距离
+static int forInstruction(const char *name, int sign, Chunk *chunk, int offset) {
+    uint8_t slot = chunk->code[offset + 1];
+    uint16_t jump = (uint16_t) (chunk->code[offset + 2] << 8);
+    jump |= chunk->code[offset + 3];
+    printf("%-16s %4d %4d -> %d\n", name, slot, offset, offset + 4 + sign * jump);
+    return offset + 4;
+}
+
+// 自增自减与复合赋值指令：target 为目标操作数的种类，最后一个字节是增量或运算指令
+typedef enum {
+    TARGET_NONE,
+    TARGET_SLOT,
+    TARGET_NAME,
+} UpdateTarget;
+
+static int updateInstruction(const char *name, UpdateTarget target, bool increment, Chunk *chunk, int offset) {
+    printf("%-16s", name);
+    if (target != TARGET_NONE) {
+        uint8_t operand = chunk->code[++offset];
+        printf(" %4d", operand);
+        if (target == TARGET_NAME) {
+            printf(" '");
+            printValue(chunk->constants.values[operand]);
+            printf("'");
+        }
+    }
+    uint8_t last = chunk->code[++offset];
+    if (increment) {
+        printf(" %+d\n", (int8_t) last);
+    } else {
+        const char *operators[] = {[OP_ADD] = "+=", [OP_SUBTRACT] = "-=", [OP_MULTIPLY] = "*=", [OP_DIVIDE] = "/="};
+        printf(" %s\n", operators[last]);
+    }
+    return offset + 1;
+}
+
 static int invokeInstruction(const char *name, Chunk *chunk, int offset) {
     uint8_t constant = chunk->code[offset + 1];
     uint8_t argCount = chunk->code[offset + 2];
@@ -144,6 +181,40 @@ int disassembleInstruction(Chunk *chunk, int offset) {
             return constantInstruction("OP_GET_PROPERTY", chunk, offset);
         case OP_SET_PROPERTY:
             return constantInstruction("OP_SET_PROPERTY", chunk, offset);
+        case OP_BUILD_LIST:
+            return byteInstruction("OP_BUILD_LIST", chunk, offset);
+        case OP_BUILD_MAP:
+            return byteInstruction("OP_BUILD_MAP", chunk, offset);
+        case OP_INDEX_GET:
+            return simpleInstruction("OP_INDEX_GET", offset);
+        case OP_INDEX_SET:
+            return simpleInstruction("OP_INDEX_SET", offset);
+        case OP_FOR_PREP:
+            return forInstruction("OP_FOR_PREP", 1, chunk, offset);
+        case OP_FOR_RANGE:
+            return forInstruction("OP_FOR_RANGE", -1, chunk, offset);
+        case OP_FOR_ITER:
+            return forInstruction("OP_FOR_ITER", -1, chunk, offset);
+        case OP_INC_LOCAL:
+            return updateInstruction("OP_INC_LOCAL", TARGET_SLOT, true, chunk, offset);
+        case OP_INC_UPVALUE:
+            return updateInstruction("OP_INC_UPVALUE", TARGET_SLOT, true, chunk, offset);
+        case OP_INC_GLOBAL:
+            return updateInstruction("OP_INC_GLOBAL", TARGET_NAME, true, chunk, offset);
+        case OP_INC_PROPERTY:
+            return updateInstruction("OP_INC_PROPERTY", TARGET_NAME, true, chunk, offset);
+        case OP_INC_INDEX:
+            return updateInstruction("OP_INC_INDEX", TARGET_NONE, true, chunk, offset);
+        case OP_COMPOUND_LOCAL:
+            return updateInstruction("OP_COMPOUND_LOCAL", TARGET_SLOT, false, chunk, offset);
+        case OP_COMPOUND_UPVALUE:
+            return updateInstruction("OP_COMPOUND_UPVALUE", TARGET_SLOT, false, chunk, offset);
+        case OP_COMPOUND_GLOBAL:
+            return updateInstruction("OP_COMPOUND_GLOBAL", TARGET_NAME, false, chunk, offset);
+        case OP_COMPOUND_PROPERTY:
+            return updateInstruction("OP_COMPOUND_PROPERTY", TARGET_NAME, false, chunk, offset);
+        case OP_COMPOUND_INDEX:
+            return updateInstruction("OP_COMPOUND_INDEX", TARGET_NONE, false, chunk, offset);
         case OP_GET_SUPER:
             return constantInstruction("OP_GET_SUPER", chunk, offset);
         case OP_EQUAL:
@@ -209,3 +280,36 @@ int disassembleInstruction(Chunk *chunk, int offset) {
             return offset + 1;
     }
 }
+
+// 输出哈希表的装载率与探测长度（键值对所在的组离其起始组要走几步）
+void printTableStats(Table *table, const char *name) {
+    if (TABLE_IS_INLINE(table)) {
+        printf("== %s ==\n", name);
+        printf("count %d, inline\n", table->count);
+        return;
+    }
+    long totalProbe = 0;
+    int maxProbe = 0;
+    int home = 0;
+    int entries = 0;
+    uint32_t groupMask = (uint32_t) (table->capacity / TABLE_GROUP_SIZE - 1);
+    for (int i = 0; i < table->capacity; i++) {
+        if (!TABLE_IS_FULL(table->control, i)) continue;
+        uint32_t group = TABLE_H1(TABLE_KEY(table->control, table->capacity, i)->hash) & groupMask;
+        int probe = 0;
+        while (group != (uint32_t) (i / TABLE_GROUP_SIZE)) {
+            group = (group + ++probe) & groupMask;
+        }
+        entries++;
+        totalProbe += probe;
+        if (probe > maxProbe) maxProbe = probe;
+        if (probe == 0) home++;
+    }
+    printf("== %s ==\n", name);
+    printf("count %d, tombstones %d, capacity %d, load %.2f, migrating %d/%d\n",
+           table->count, table->tombstones, table->capacity,
+           (double) (table->count + table->tombstones) / table->capacity,
+           table->migrated, table->oldCapacity);
+    printf("probe avg %.3f, max %d, at home %d\n",
+           entries == 0 ? 0.0 : (double) totalProbe / entries, maxProbe, home);
+}
@@ -6,11 +6,15 @@
 #define PANDA_DEBUG_H
 
 #include "chunk.h"
+#include "table.h"
 
 
 void disassembleChunk(Chunk *chunk, const char *name);
 
 int disassembleInstruction(Chunk *chunk, int offset);
 
+// 输出哈希表的装载率与探测长度
+void printTableStats(Table *table, const char *name);
+
 
 #endif //PANDA_DEBUG_H
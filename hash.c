@@ -0,0 +1,111 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#include <string.h>
+
+#include "hash.h"
+
+#ifdef STRING_HASH_FNV1A
+
+// FNV-1a：逐字节
+uint32_t hashString(const char *key, int length) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (uint8_t) key[i];
+        hash *= 16777619;
+    }
+    return hash;
+}
+
+#else
+
+// wyhash 的常数
+static const uint64_t wySecret[4] = {
+        0xa0761d6478bd642full, 0xe7037ed1a0b428dbull,
+        0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull,
+};
+
+// 64 位乘法，a、b 分别得到 128 位乘积的低、高 64 位
+static inline void wyMultiply(uint64_t *a, uint64_t *b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t product = (__uint128_t) *a * *b;
+    *a = (uint64_t) product;
+    *b = (uint64_t) (product >> 64);
+#else
+    uint64_t ha = *a >> 32, hb = *b >> 32, la = (uint32_t) *a, lb = (uint32_t) *b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *a = lo;
+    *b = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+static inline uint64_t wyMix(uint64_t a, uint64_t b) {
+    wyMultiply(&a, &b);
+    return a ^ b;
+}
+
+// 不对齐读取（按本机字节序，哈希值只在进程内使用）
+static inline uint64_t wyRead8(const uint8_t *p) {
+    uint64_t value;
+    memcpy(&value, p, 8);
+    return value;
+}
+
+static inline uint64_t wyRead4(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, 4);
+    return value;
+}
+
+// wyhash：每次处理 8 字节，长串三路并行
+uint32_t hashString(const char *key, int length) {
+    const uint8_t *p = (const uint8_t *) key;
+    size_t len = (size_t) length;
+    uint64_t seed = wyMix(wySecret[0], wySecret[1]);
+    uint64_t a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            // 首尾各取两个可能重叠的 4 字节，覆盖全部字符
+            size_t middle = (len >> 3) << 2;
+            a = (wyRead4(p) << 32) | wyRead4(p + middle);
+            b = (wyRead4(p + len - 4) << 32) | wyRead4(p + len - 4 - middle);
+        } else if (len > 0) {
+            a = ((uint64_t) p[0] << 16) | ((uint64_t) p[len >> 1] << 8) | p[len - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed = wyMix(wyRead8(p) ^ wySecret[1], wyRead8(p + 8) ^ seed);
+                seed1 = wyMix(wyRead8(p + 16) ^ wySecret[2], wyRead8(p + 24) ^ seed1);
+                seed2 = wyMix(wyRead8(p + 32) ^ wySecret[3], wyRead8(p + 40) ^ seed2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        while (i > 16) {
+            seed = wyMix(wyRead8(p) ^ wySecret[1], wyRead8(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        // 最后 16 字节（可能与已处理的部分重叠）
+        a = wyRead8(p + i - 16);
+        b = wyRead8(p + i - 8);
+    }
+    a ^= wySecret[1];
+    b ^= seed;
+    wyMultiply(&a, &b);
+    uint64_t hash = wyMix(a ^ wySecret[0] ^ len, b ^ wySecret[1]);
+    return (uint32_t) (hash ^ (hash >> 32));
+}
+
+#endif
@@ -0,0 +1,15 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#ifndef PANDA_HASH_H
+#define PANDA_HASH_H
+
+#include "common.h"
+
+// 输入字符数组和长度、计算字符串的 hash 值
+// 默认为 wyhash，定义 STRING_HASH_FNV1A 时使用逐字节的 FNV-1a（bench/hash_bench.c 比较两者）
+// 4 字节左右的短键两者的吞吐量在测量波动之内，谁快不固定；12 字节起 wyhash 明显更快
+uint32_t hashString(const char *key, int length);
+
+#endif //PANDA_HASH_H
@@ -0,0 +1,782 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "json.h"
+#include "map.h"
+#include "memory.h"
+#include "vm.h"
+
+// 10 的 0 到 22 次幂都能用 double 精确表示
+static const double powersOfTen[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+// 2^53，小于它的整数都能用 double 精确表示
+#define EXACT_INTEGER_LIMIT 9007199254740992.0
+
+// 跳到第一个引号、反斜杠或控制字符（解析时字符串在这些位置结束或需要转义，序列化时这些字符需要转义）
+static const char *scanString(const char *p, const char *end) {
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    const __m128i zero = _mm_setzero_si128();
+    while (end - p >= 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) p);
+        // 饱和减法后为 0 即不大于 0x1f
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                       _mm_cmpeq_epi8(_mm_subs_epu8(chunk, control), zero));
+        int mask = _mm_movemask_epi8(special);
+        if (mask != 0) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && *p != '"' && *p != '\\' && (uint8_t) *p >= 0x20) p++;
+    return p;
+}
+
+// 第一阶段：找出所有结构字符的位置（simdjson 的做法），每次处理 64 字节
+// 索引包括字符串外的 { } [ ] : ,、字符串的开引号以及数字和字面量的第一个字符，第二阶段只需按顺序访问这些位置
+
+// 64 字节块中各类字符的位掩码，第 i 位对应块内第 i 个字节
+typedef struct {
+    uint64_t quote;
+    uint64_t backslash;
+    // { } [ ] : ,
+    uint64_t structural;
+    uint64_t whitespace;
+} JsonBlock;
+
+#ifdef __SSE2__
+
+static inline uint64_t matchChar(__m128i chunk, char c) {
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, _mm_set1_epi8(c)));
+}
+
+static void classifyBlock(const uint8_t *block, JsonBlock *masks) {
+    *masks = (JsonBlock) {0, 0, 0, 0};
+    for (int i = 0; i < 4; i++) {
+        __m128i chunk = _mm_loadu_si128((const __m128i *) (block + 16 * i));
+        int shift = 16 * i;
+        masks->quote |= matchChar(chunk, '"') << shift;
+        masks->backslash |= matchChar(chunk, '\\') << shift;
+        masks->structural |= (matchChar(chunk, '{') | matchChar(chunk, '}') | matchChar(chunk, '[') |
+                              matchChar(chunk, ']') | matchChar(chunk, ':') | matchChar(chunk, ',')) << shift;
+        masks->whitespace |= (matchChar(chunk, ' ') | matchChar(chunk, '\t') | matchChar(chunk, '\n') |
+                              matchChar(chunk, '\r')) << shift;
+    }
+}
+
+#else
+
+static void classifyBlock(const uint8_t *block, JsonBlock *masks) {
+    *masks = (JsonBlock) {0, 0, 0, 0};
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = (uint64_t) 1 << i;
+        switch (block[i]) {
+            case '"':
+                masks->quote |= bit;
+                break;
+            case '\\':
+                masks->backslash |= bit;
+                break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                masks->structural |= bit;
+                break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                masks->whitespace |= bit;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+#endif
+
+// 前缀异或：第 i 位为第 0 到 i 位的异或，对引号掩码计算后即为每个字节是否在字符串内（包括开引号）
+static inline uint64_t prefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+typedef struct {
+    ObjString *source;
+    const char *chars;
+    uint32_t length;
+    // 结构字符的位置，最后一项为 length（哨兵）
+    uint32_t *indexes;
+    uint32_t count;
+    // 第二阶段下一个要访问的索引
+    uint32_t next;
+} JsonParser;
+
+// 建立结构索引，存在未结束的字符串时返回 false
+static bool buildIndex(JsonParser *parser) {
+    const uint8_t *chars = (const uint8_t *) parser->chars;
+    uint32_t length = parser->length;
+    uint32_t *indexes = parser->indexes;
+    uint32_t count = 0;
+    // 上一块结束时的状态：是否在字符串内（全 1 或全 0）、最后一个字节是否为未被转义的反斜杠、最后一个字节是否属于数字或字面量
+    uint64_t inStringCarry = 0;
+    uint64_t escapeCarry = 0;
+    uint64_t scalarCarry = 0;
+    uint8_t padded[64];
+
+    for (uint32_t offset = 0; offset < length; offset += 64) {
+        const uint8_t *block = chars + offset;
+        if (length - offset < 64) {
+            // 最后不足 64 字节的部分用空白补齐
+            memset(padded, ' ', sizeof(padded));
+            memcpy(padded, block, length - offset);
+            block = padded;
+        }
+        JsonBlock masks;
+        classifyBlock(block, &masks);
+
+        // 被转义的字符：反斜杠本身没有被转义时，它后面的字符被转义（反斜杠很少，逐个处理）
+        uint64_t escaped = escapeCarry;
+        escapeCarry = 0;
+        for (uint64_t bits = masks.backslash; bits != 0; bits &= bits - 1) {
+            int i = __builtin_ctzll(bits);
+            if ((escaped >> i) & 1) continue;
+            if (i == 63) {
+                escapeCarry = 1;
+            } else {
+                escaped |= (uint64_t) 2 << i;
+            }
+        }
+
+        uint64_t quote = masks.quote & ~escaped;
+        uint64_t inString = prefixXor(quote) ^ inStringCarry;
+        inStringCarry = (uint64_t) ((int64_t) inString >> 63);
+        // 数字和字面量只记录第一个字节
+        uint64_t scalar = ~(masks.structural | masks.whitespace | quote | inString);
+        uint64_t scalarStart = scalar & ~((scalar << 1) | scalarCarry);
+        scalarCarry = scalar >> 63;
+
+        uint64_t bits = (masks.structural & ~inString) | (quote & inString) | scalarStart;
+        while (bits != 0) {
+            indexes[count++] = offset + __builtin_ctzll(bits);
+            bits &= bits - 1;
+        }
+    }
+    // 补齐的空白不会产生索引，count 不超过 length
+    parser->count = count;
+    indexes[count] = length;
+    return inStringCarry == 0;
+}
+
+// 第二阶段：按索引递归构建值，每个值解析完后留在虚拟机栈上（构建过程中的容器都能被 GC 找到）
+
+static char charAt(JsonParser *parser, uint32_t position) {
+    return position < parser->length ? parser->chars[position] : '\0';
+}
+
+// 取下一个结构字符的位置，没有时返回 length
+static uint32_t nextIndex(JsonParser *parser) {
+    return parser->indexes[parser->next < parser->count ? parser->next++ : parser->count];
+}
+
+static uint32_t peekIndex(JsonParser *parser) {
+    return parser->indexes[parser->next];
+}
+
+static bool unexpected(JsonParser *parser, uint32_t position) {
+    if (position >= parser->length) {
+        runtimeError("Unexpected end of JSON input.");
+    } else {
+        runtimeError("Unexpected character '%c' at offset %u in JSON input.", parser->chars[position], position);
+    }
+    return false;
+}
+
+// 数字和字面量后面必须是空白、结构字符或输入结尾
+static bool isBoundary(JsonParser *parser, uint32_t position) {
+    switch (charAt(parser, position)) {
+        case '\0':
+            return position >= parser->length;
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+        case ',':
+        case ':':
+        case ']':
+        case '}':
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool parseLiteral(JsonParser *parser, uint32_t position, const char *literal, int length, Value value) {
+    if (parser->length - position < (uint32_t) length || memcmp(parser->chars + position, literal, length) != 0) {
+        return unexpected(parser, position);
+    }
+    if (!isBoundary(parser, position + length)) return unexpected(parser, position + length);
+    push(value);
+    return true;
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// 整数且在 int32 范围内时得到小整数；有效数字不超过 19 位且可以精确计算时不调用 strtod
+static bool parseNumber(JsonParser *parser, uint32_t position) {
+    const char *start = parser->chars + position;
+    const char *end = parser->chars + parser->length;
+    const char *p = start;
+    bool negative = false;
+    if (*p == '-') {
+        negative = true;
+        p++;
+    }
+    if (p >= end || !isDigit(*p)) return unexpected(parser, (uint32_t) (p - parser->chars));
+
+    // 十进制有效数字 mantissa 乘以 10 的 exponent 次幂；exact 表示没有丢弃有效数字
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool exact = true;
+    bool integer = true;
+    if (*p == '0') {
+        p++;
+    } else {
+        for (; p < end && isDigit(*p); p++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                digits++;
+            } else {
+                exponent++;
+                exact = false;
+            }
+        }
+    }
+    if (p < end && *p == '.') {
+        integer = false;
+        p++;
+        if (p >= end || !isDigit(*p)) return unexpected(parser, (uint32_t) (p - parser->chars));
+        for (; p < end && isDigit(*p); p++) {
+            if (digits < 19) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if (mantissa != 0) digits++;
+                exponent--;
+            } else {
+                exact = false;
+            }
+        }
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        integer = false;
+        p++;
+        bool negativeExponent = false;
+        if (p < end && (*p == '+' || *p == '-')) {
+            negativeExponent = *p == '-';
+            p++;
+        }
+        if (p >= end || !isDigit(*p)) return unexpected(parser, (uint32_t) (p - parser->chars));
+        int value = 0;
+        for (; p < end && isDigit(*p); p++) {
+            if (value < 100000) value = value * 10 + (*p - '0');
+        }
+        exponent += negativeExponent ? -value : value;
+    }
+    uint32_t numberEnd = (uint32_t) (p - parser->chars);
+    if (!isBoundary(parser, numberEnd)) return unexpected(parser, numberEnd);
+
+    if (integer && exact && mantissa <= (negative ? (uint64_t) INT32_MAX + 1 : INT32_MAX)) {
+        if (negative && mantissa == 0) {
+            push(NUMBER_VAL(-0.0));
+        } else {
+            push(INT_VAL((int32_t) (negative ? -(int64_t) mantissa : (int64_t) mantissa)));
+        }
+        return true;
+    }
+    double number;
+    if (exact && mantissa < EXACT_INTEGER_LIMIT && exponent >= -22 && exponent <= 22) {
+        // 有效数字和 10 的幂都是精确的，一次乘除只舍入一次，结果与 strtod 相同
+        number = (double) mantissa;
+        number = exponent < 0 ? number / powersOfTen[-exponent] : number * powersOfTen[exponent];
+        if (negative) number = -number;
+    } else {
+        // 输入不一定以 '\0' 结尾，复制出来再交给 strtod
+        size_t length = (size_t) (p - start);
+        char buffer[64];
+        char *copy = length < sizeof(buffer) ? buffer : malloc(length + 1);
+        if (copy == NULL) exit(1);
+        memcpy(copy, start, length);
+        copy[length] = '\0';
+        number = strtod(copy, NULL);
+        if (copy != buffer) free(copy);
+    }
+    push(NUMBER_VAL(number));
+    return true;
+}
+
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 读取 \u 后面的 4 位十六进制数，失败时返回 -1
+static int readCodeUnit(const char *p, const char *end) {
+    if (end - p < 4) return -1;
+    int value = 0;
+    for (int i = 0; i < 4; i++) {
+        int digit = hexDigit(p[i]);
+        if (digit < 0) return -1;
+        value = value * 16 + digit;
+    }
+    return value;
+}
+
+static int encodeUtf8(uint32_t codePoint, char *out) {
+    if (codePoint < 0x80) {
+        out[0] = (char) codePoint;
+        return 1;
+    }
+    if (codePoint < 0x800) {
+        out[0] = (char) (0xc0 | (codePoint >> 6));
+        out[1] = (char) (0x80 | (codePoint & 0x3f));
+        return 2;
+    }
+    if (codePoint < 0x10000) {
+        out[0] = (char) (0xe0 | (codePoint >> 12));
+        out[1] = (char) (0x80 | ((codePoint >> 6) & 0x3f));
+        out[2] = (char) (0x80 | (codePoint & 0x3f));
+        return 3;
+    }
+    out[0] = (char) (0xf0 | (codePoint >> 18));
+    out[1] = (char) (0x80 | ((codePoint >> 12) & 0x3f));
+    out[2] = (char) (0x80 | ((codePoint >> 6) & 0x3f));
+    out[3] = (char) (0x80 | (codePoint & 0x3f));
+    return 4;
+}
+
+// 解析 position 处开引号开始的字符串；键驻留，值不驻留（没有转义时较长的值是源文本的子串视图）
+static bool parseString(JsonParser *parser, uint32_t position, bool isKey) {
+    const char *start = parser->chars + position + 1;
+    const char *end = parser->chars + parser->length;
+    const char *p = scanString(start, end);
+    if (p < end && *p == '"') {
+        int length = (int) (p - start);
+        ObjString *string = isKey ? copyString(start, length)
+                                  : substring(parser->source, (int) (start - parser->source->chars), length);
+        push(OBJ_VAL(string));
+        return true;
+    }
+
+    // 有转义：结果不会比源文本长，而字符串在下一个结构字符之前结束
+    int capacity = (int) (peekIndex(parser) - position);
+    char *chars = allocateStringBuffer(capacity);
+    int length = (int) (p - start);
+    memcpy(chars, start, length);
+    for (;;) {
+        if (p >= end || (uint8_t) *p < 0x20) {
+            reallocateStringBuffer(chars, capacity, 0);
+            if (p >= end) {
+                runtimeError("Unterminated string in JSON input.");
+                return false;
+            }
+            return unexpected(parser, (uint32_t) (p - parser->chars));
+        }
+        if (*p == '"') break;
+        if (*p != '\\') {
+            // 复制到下一个需要处理的字符
+            const char *run = scanString(p, end);
+            memcpy(chars + length, p, run - p);
+            length += (int) (run - p);
+            p = run;
+            continue;
+        }
+        p++;
+        char escape = p < end ? *p++ : '\0';
+        switch (escape) {
+            case '"':
+            case '\\':
+            case '/':
+                chars[length++] = escape;
+                break;
+            case 'b':
+                chars[length++] = '\b';
+                break;
+            case 'f':
+                chars[length++] = '\f';
+                break;
+            case 'n':
+                chars[length++] = '\n';
+                break;
+            case 'r':
+                chars[length++] = '\r';
+                break;
+            case 't':
+                chars[length++] = '\t';
+                break;
+            case 'u': {
+                int unit = readCodeUnit(p, end);
+                uint32_t codePoint = (uint32_t) unit;
+                p += 4;
+                if (unit >= 0xd800 && unit <= 0xdbff) {
+                    // 代理对
+                    int low = end - p >= 6 && p[0] == '\\' && p[1] == 'u' ? readCodeUnit(p + 2, end) : -1;
+                    if (low < 0xdc00 || low > 0xdfff) unit = -1;
+                    codePoint = 0x10000 + (((uint32_t) unit - 0xd800) << 10) + ((uint32_t) low - 0xdc00);
+                    p += 6;
+                } else if (unit >= 0xdc00 && unit <= 0xdfff) {
+                    unit = -1;
+                }
+                if (unit < 0) {
+                    reallocateStringBuffer(chars, capacity, 0);
+                    runtimeError("Invalid unicode escape in JSON string.");
+                    return false;
+                }
+                length += encodeUtf8(codePoint, chars + length);
+                break;
+            }
+            default:
+                reallocateStringBuffer(chars, capacity, 0);
+                runtimeError("Invalid escape in JSON string.");
+                return false;
+        }
+    }
+
+    if (isKey) {
+        push(OBJ_VAL(copyString(chars, length)));
+        reallocateStringBuffer(chars, capacity, 0);
+    } else {
+        push(OBJ_VAL(takeString(chars, length, capacity)));
+    }
+    return true;
+}
+
+static bool parseValue(JsonParser *parser, int depth);
+
+static bool parseArray(JsonParser *parser, int depth) {
+    ObjList *list = newList(0);
+    push(OBJ_VAL(list));
+    if (charAt(parser, peekIndex(parser)) == ']') {
+        nextIndex(parser);
+        return true;
+    }
+    for (;;) {
+        if (!parseValue(parser, depth + 1)) return false;
+        writeValueArray(&list->items, vm.stackTop[-1]);
+        pop();
+        uint32_t position = nextIndex(parser);
+        char c = charAt(parser, position);
+        if (c == ']') return true;
+        if (c != ',') return unexpected(parser, position);
+    }
+}
+
+static bool parseObject(JsonParser *parser, int depth) {
+    ObjMap *map = newMap();
+    push(OBJ_VAL(map));
+    if (charAt(parser, peekIndex(parser)) == '}') {
+        nextIndex(parser);
+        return true;
+    }
+    for (;;) {
+        uint32_t position = nextIndex(parser);
+        if (charAt(parser, position) != '"') return unexpected(parser, position);
+        if (!parseString(parser, position, true)) return false;
+        position = nextIndex(parser);
+        if (charAt(parser, position) != ':') return unexpected(parser, position);
+        if (!parseValue(parser, depth + 1)) return false;
+        // 重复的键以最后一个为准
+        mapSet(map, vm.stackTop[-2], vm.stackTop[-1]);
+        pop();
+        pop();
+        position = nextIndex(parser);
+        char c = charAt(parser, position);
+        if (c == '}') return true;
+        if (c != ',') return unexpected(parser, position);
+    }
+}
+
+static bool parseValue(JsonParser *parser, int depth) {
+    if (depth > JSON_MAX_DEPTH) {
+        runtimeError("JSON input is nested deeper than %d levels.", JSON_MAX_DEPTH);
+        return false;
+    }
+    uint32_t position = nextIndex(parser);
+    switch (charAt(parser, position)) {
+        case '{':
+            return parseObject(parser, depth);
+        case '[':
+            return parseArray(parser, depth);
+        case '"':
+            return parseString(parser, position, false);
+        case 't':
+            return parseLiteral(parser, position, "true", 4, BOOL_VAL(true));
+        case 'f':
+            return parseLiteral(parser, position, "false", 5, BOOL_VAL(false));
+        case 'n':
+            return parseLiteral(parser, position, "null", 4, NIL_VAL);
+        case '-':
+        case '0':
+        case '1':
+        case '2':
+        case '3':
+        case '4':
+        case '5':
+        case '6':
+        case '7':
+        case '8':
+        case '9':
+            return parseNumber(parser, position);
+        default:
+            return unexpected(parser, position);
+    }
+}
+
+bool jsonParse(ObjString *source, Value *result) {
+    JsonParser parser;
+    parser.source = source;
+    parser.chars = source->chars;
+    parser.length = (uint32_t) source->length;
+    parser.indexes = malloc(sizeof(uint32_t) * ((size_t) parser.length + 1));
+    if (parser.indexes == NULL) exit(1);
+    parser.next = 0;
+
+    bool ok = false;
+    if (!buildIndex(&parser)) {
+        runtimeError("Unterminated string in JSON input.");
+    } else if (parseValue(&parser, 0)) {
+        uint32_t position = nextIndex(&parser);
+        if (position < parser.length) {
+            unexpected(&parser, position);
+        } else {
+            *result = pop();
+            ok = true;
+        }
+    }
+    free(parser.indexes);
+    return ok;
+}
+
+// 序列化：写入可增长的字符串缓冲区，结束后直接转为字符串
+typedef struct {
+    char *chars;
+    int length;
+    int capacity;
+} JsonWriter;
+
+static void writerReserve(JsonWriter *writer, int count) {
+    if (writer->length + count <= writer->capacity) return;
+    int capacity = GROW_CAPACITY(writer->capacity);
+    if (capacity < writer->length + count) capacity = writer->length + count;
+    writer->chars = reallocateStringBuffer(writer->chars, writer->capacity, capacity);
+    writer->capacity = capacity;
+}
+
+static void writeChars(JsonWriter *writer, const char *chars, int length) {
+    writerReserve(writer, length);
+    memcpy(writer->chars + writer->length, chars, length);
+    writer->length += length;
+}
+
+static void writeChar(JsonWriter *writer, char c) {
+    writerReserve(writer, 1);
+    writer->chars[writer->length++] = c;
+}
+
+// 写入整数的十进制表示，pointPosition 大于 0 时在倒数第 pointPosition 位前加小数点
+static void writeDigits(JsonWriter *writer, int64_t value, int pointPosition) {
+    char digits[24];
+    int count = 0;
+    uint64_t magnitude = value < 0 ? -(uint64_t) value : (uint64_t) value;
+    do {
+        digits[count++] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    // 小数点前至少有一位
+    while (count <= pointPosition) digits[count++] = '0';
+    writerReserve(writer, count + 2);
+    if (value < 0) writer->chars[writer->length++] = '-';
+    while (count > 0) {
+        if (count == pointPosition) writer->chars[writer->length++] = '.';
+        writer->chars[writer->length++] = digits[--count];
+    }
+}
+
+// 数字按能精确还原的最短形式写入：整数直接转换；小数位不多的数找最小的 k 使 x * 10^k 为整数且除回去等于 x；
+// 其余的才用 printf
+static void writeNumber(JsonWriter *writer, Value value) {
+    if (IS_INT(value)) {
+        writeDigits(writer, AS_INT(value), 0);
+        return;
+    }
+    double number = AS_NUMBER(value);
+    if (!isfinite(number)) {
+        writeChars(writer, "null", 4);
+        return;
+    }
+    if (number == trunc(number) && fabs(number) < EXACT_INTEGER_LIMIT) {
+        if (number == 0 && signbit(number)) {
+            writeChars(writer, "-0", 2);
+        } else {
+            writeDigits(writer, (int64_t) number, 0);
+        }
+        return;
+    }
+    for (int k = 1; k <= 22; k++) {
+        double scaled = number * powersOfTen[k];
+        if (fabs(scaled) >= EXACT_INTEGER_LIMIT) break;
+        double digits = nearbyint(scaled);
+        // 除以 10 的精确幂只舍入一次，相等说明这个十进制数解析后就是 number
+        if (digits / powersOfTen[k] == number) {
+            writeDigits(writer, (int64_t) digits, k);
+            return;
+        }
+    }
+    char buffer[32];
+    int length = 0;
+    for (int precision = 15; precision <= 17; precision++) {
+        length = snprintf(buffer, sizeof(buffer), "%.*g", precision, number);
+        if (strtod(buffer, NULL) == number) break;
+    }
+    writeChars(writer, buffer, length);
+}
+
+static void writeString(JsonWriter *writer, ObjString *string) {
+    const char *p = string->chars;
+    const char *end = p + string->length;
+    writerReserve(writer, string->length + 2);
+    writer->chars[writer->length++] = '"';
+    for (;;) {
+        const char *run = scanString(p, end);
+        writeChars(writer, p, (int) (run - p));
+        p = run;
+        if (p >= end) break;
+        char c = *p++;
+        switch (c) {
+            case '"':
+                writeChars(writer, "\\\"", 2);
+                break;
+            case '\\':
+                writeChars(writer, "\\\\", 2);
+                break;
+            case '\b':
+                writeChars(writer, "\\b", 2);
+                break;
+            case '\f':
+                writeChars(writer, "\\f", 2);
+                break;
+            case '\n':
+                writeChars(writer, "\\n", 2);
+                break;
+            case '\r':
+                writeChars(writer, "\\r", 2);
+                break;
+            case '\t':
+                writeChars(writer, "\\t", 2);
+                break;
+            default: {
+                char escape[7];
+                snprintf(escape, sizeof(escape), "\\u%04x", (uint8_t) c);
+                writeChars(writer, escape, 6);
+                break;
+            }
+        }
+    }
+    writeChar(writer, '"');
+}
+
+// 写入 value，嵌套过深（包括循环引用）时报错
+static bool writeValue(JsonWriter *writer, Value value, int depth) {
+    if (depth > JSON_MAX_DEPTH) {
+        runtimeError("Cannot convert values nested deeper than %d levels to JSON.", JSON_MAX_DEPTH);
+        return false;
+    }
+    if (IS_NIL(value)) {
+        writeChars(writer, "null", 4);
+    } else if (IS_BOOL(value)) {
+        if (AS_BOOL(value)) {
+            writeChars(writer, "true", 4);
+        } else {
+            writeChars(writer, "false", 5);
+        }
+    } else if (IS_NUMBER(value)) {
+        writeNumber(writer, value);
+    } else if (IS_ANY_STRING(value)) {
+        // 展开 rope 可能触发 GC，rope 仍能从被序列化的值找到
+        writeString(writer, IS_ROPE(value) ? flattenRope(AS_ROPE(value)) : AS_STRING(value));
+    } else if (IS_LIST(value)) {
+        ObjList *list = AS_LIST(value);
+        writeChar(writer, '[');
+        for (int i = 0; i < list->items.count; i++) {
+            if (i > 0) writeChar(writer, ',');
+            if (!writeValue(writer, list->items.values[i], depth + 1)) return false;
+        }
+        writeChar(writer, ']');
+    } else if (IS_MAP(value)) {
+        ObjMap *map = AS_MAP(value);
+        writeChar(writer, '{');
+        bool first = true;
+        for (int i = 0; i < map->entryCount; i++) {
+            MapEntry *entry = &map->entries[i];
+            // 已删除的键值对
+            if (IS_NIL(entry->key)) continue;
+            if (!IS_ANY_STRING(entry->key)) {
+                runtimeError("JSON object keys must be strings.");
+                return false;
+            }
+            if (!first) writeChar(writer, ',');
+            first = false;
+            if (!writeValue(writer, entry->key, depth + 1)) return false;
+            writeChar(writer, ':');
+            if (!writeValue(writer, map->entries[i].value, depth + 1)) return false;
+        }
+        writeChar(writer, '}');
+    } else if (IS_TYPED_ARRAY(value)) {
+        ObjTypedArray *array = AS_TYPED_ARRAY(value);
+        writeChar(writer, '[');
+        for (int i = 0; i < array->length; i++) {
+            if (i > 0) writeChar(writer, ',');
+            writeNumber(writer, typedArrayGet(array, i));
+        }
+        writeChar(writer, ']');
+    } else {
+        runtimeError("Only nil, booleans, numbers, strings, lists, maps and typed arrays can be converted to JSON.");
+        return false;
+    }
+    return true;
+}
+
+bool jsonStringify(Value value, Value *result) {
+    JsonWriter writer = {NULL, 0, 0};
+    if (!writeValue(&writer, value, 0)) {
+        reallocateStringBuffer(writer.chars, writer.capacity, 0);
+        return false;
+    }
+    *result = OBJ_VAL(takeString(writer.chars, writer.length, writer.capacity));
+    return true;
+}
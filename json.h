@@ -0,0 +1,19 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#ifndef PANDA_JSON_H
+#define PANDA_JSON_H
+
+#include "common.h"
+#include "object.h"
+
+// 解析 JSON 文本：对象转为映射（键驻留），数组转为列表，整数尽量转为小整数
+// 出错时报告运行时错误并返回 false
+bool jsonParse(ObjString *source, Value *result);
+
+// 将 nil、布尔值、数字、字符串、列表、映射（键必须是字符串）和数值数组序列化为 JSON 文本
+// NaN 与无穷大写为 null；出错时报告运行时错误并返回 false
+bool jsonStringify(Value value, Value *result);
+
+#endif //PANDA_JSON_H
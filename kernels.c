@@ -0,0 +1,271 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#include "kernels.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define KERNELS_AVX
+#endif
+
+Float64Kernels float64Kernels;
+
+// 逐个计算的实现，也用于处理向量化循环剩下的元素
+
+static double sumScalar(const double *x, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += x[i];
+    return sum;
+}
+
+static double dotScalar(const double *x, const double *y, int n) {
+    double sum = 0;
+    for (int i = 0; i < n; i++) sum += x[i] * y[i];
+    return sum;
+}
+
+static double minScalar(const double *x, int n) {
+    double min = x[0];
+    for (int i = 1; i < n; i++) min = x[i] < min ? x[i] : min;
+    return min;
+}
+
+static double maxScalar(const double *x, int n) {
+    double max = x[0];
+    for (int i = 1; i < n; i++) max = x[i] > max ? x[i] : max;
+    return max;
+}
+
+static void scaleScalar(double *x, double k, int n) {
+    for (int i = 0; i < n; i++) x[i] *= k;
+}
+
+static void axpyScalar(double *y, double a, const double *x, int n) {
+    for (int i = 0; i < n; i++) y[i] += a * x[i];
+}
+
+static void addScalar(double *y, const double *x, int n) {
+    for (int i = 0; i < n; i++) y[i] += x[i];
+}
+
+static void mulScalar(double *y, const double *x, int n) {
+    for (int i = 0; i < n; i++) y[i] *= x[i];
+}
+
+static void prefixSumScalar(double *x, int n) {
+    for (int i = 1; i < n; i++) x[i] += x[i - 1];
+}
+
+#ifdef __SSE2__
+
+// SSE2：每次处理 2 个 double，求和使用两组累加器
+
+static double horizontalSum2(__m128d v) {
+    return _mm_cvtsd_f64(_mm_add_sd(v, _mm_unpackhi_pd(v, v)));
+}
+
+static double sumSse2(const double *x, int n) {
+    __m128d a = _mm_setzero_pd();
+    __m128d b = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        a = _mm_add_pd(a, _mm_loadu_pd(x + i));
+        b = _mm_add_pd(b, _mm_loadu_pd(x + i + 2));
+    }
+    return horizontalSum2(_mm_add_pd(a, b)) + sumScalar(x + i, n - i);
+}
+
+static double dotSse2(const double *x, const double *y, int n) {
+    __m128d a = _mm_setzero_pd();
+    __m128d b = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        a = _mm_add_pd(a, _mm_mul_pd(_mm_loadu_pd(x + i), _mm_loadu_pd(y + i)));
+        b = _mm_add_pd(b, _mm_mul_pd(_mm_loadu_pd(x + i + 2), _mm_loadu_pd(y + i + 2)));
+    }
+    return horizontalSum2(_mm_add_pd(a, b)) + dotScalar(x + i, y + i, n - i);
+}
+
+static double minSse2(const double *x, int n) {
+    if (n < 2) return x[0];
+    __m128d m = _mm_loadu_pd(x);
+    int i = 2;
+    for (; i + 2 <= n; i += 2) m = _mm_min_pd(m, _mm_loadu_pd(x + i));
+    double lanes[2];
+    _mm_storeu_pd(lanes, m);
+    double min = lanes[0] < lanes[1] ? lanes[0] : lanes[1];
+    for (; i < n; i++) min = x[i] < min ? x[i] : min;
+    return min;
+}
+
+static double maxSse2(const double *x, int n) {
+    if (n < 2) return x[0];
+    __m128d m = _mm_loadu_pd(x);
+    int i = 2;
+    for (; i + 2 <= n; i += 2) m = _mm_max_pd(m, _mm_loadu_pd(x + i));
+    double lanes[2];
+    _mm_storeu_pd(lanes, m);
+    double max = lanes[0] > lanes[1] ? lanes[0] : lanes[1];
+    for (; i < n; i++) max = x[i] > max ? x[i] : max;
+    return max;
+}
+
+static void scaleSse2(double *x, double k, int n) {
+    __m128d factor = _mm_set1_pd(k);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(x + i, _mm_mul_pd(_mm_loadu_pd(x + i), factor));
+    scaleScalar(x + i, k, n - i);
+}
+
+static void axpySse2(double *y, double a, const double *x, int n) {
+    __m128d factor = _mm_set1_pd(a);
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_mul_pd(factor, _mm_loadu_pd(x + i))));
+    }
+    axpyScalar(y + i, a, x + i, n - i);
+}
+
+static void addSse2(double *y, const double *x, int n) {
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(y + i, _mm_add_pd(_mm_loadu_pd(y + i), _mm_loadu_pd(x + i)));
+    addScalar(y + i, x + i, n - i);
+}
+
+static void mulSse2(double *y, const double *x, int n) {
+    int i = 0;
+    for (; i + 2 <= n; i += 2) _mm_storeu_pd(y + i, _mm_mul_pd(_mm_loadu_pd(y + i), _mm_loadu_pd(x + i)));
+    mulScalar(y + i, x + i, n - i);
+}
+
+// 每次处理 2 个元素：[a, b] 先变为 [a, a + b]，再加上前面所有元素的和
+static void prefixSumSse2(double *x, int n) {
+    __m128d carry = _mm_setzero_pd();
+    int i = 0;
+    for (; i + 2 <= n; i += 2) {
+        __m128d v = _mm_loadu_pd(x + i);
+        v = _mm_add_pd(v, _mm_unpacklo_pd(_mm_setzero_pd(), v));
+        v = _mm_add_pd(v, carry);
+        _mm_storeu_pd(x + i, v);
+        carry = _mm_unpackhi_pd(v, v);
+    }
+    if (i < n) x[i] += i > 0 ? x[i - 1] : 0;
+}
+
+#endif
+
+#ifdef KERNELS_AVX
+
+// AVX：每次处理 4 个 double，只在运行时检测到 CPU 支持时使用
+
+#define AVX __attribute__((target("avx")))
+
+AVX static double horizontalSum4(__m256d v) {
+    __m128d low = _mm256_castpd256_pd128(v);
+    __m128d high = _mm256_extractf128_pd(v, 1);
+    low = _mm_add_pd(low, high);
+    return _mm_cvtsd_f64(_mm_add_sd(low, _mm_unpackhi_pd(low, low)));
+}
+
+AVX static double sumAvx(const double *x, int n) {
+    __m256d a = _mm256_setzero_pd();
+    __m256d b = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        a = _mm256_add_pd(a, _mm256_loadu_pd(x + i));
+        b = _mm256_add_pd(b, _mm256_loadu_pd(x + i + 4));
+    }
+    return horizontalSum4(_mm256_add_pd(a, b)) + sumScalar(x + i, n - i);
+}
+
+AVX static double dotAvx(const double *x, const double *y, int n) {
+    __m256d a = _mm256_setzero_pd();
+    __m256d b = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        a = _mm256_add_pd(a, _mm256_mul_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+        b = _mm256_add_pd(b, _mm256_mul_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4)));
+    }
+    return horizontalSum4(_mm256_add_pd(a, b)) + dotScalar(x + i, y + i, n - i);
+}
+
+AVX static double minAvx(const double *x, int n) {
+    if (n < 4) return minScalar(x, n);
+    __m256d m = _mm256_loadu_pd(x);
+    int i = 4;
+    for (; i + 4 <= n; i += 4) m = _mm256_min_pd(m, _mm256_loadu_pd(x + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, m);
+    double min = minScalar(lanes, 4);
+    for (; i < n; i++) min = x[i] < min ? x[i] : min;
+    return min;
+}
+
+AVX static double maxAvx(const double *x, int n) {
+    if (n < 4) return maxScalar(x, n);
+    __m256d m = _mm256_loadu_pd(x);
+    int i = 4;
+    for (; i + 4 <= n; i += 4) m = _mm256_max_pd(m, _mm256_loadu_pd(x + i));
+    double lanes[4];
+    _mm256_storeu_pd(lanes, m);
+    double max = maxScalar(lanes, 4);
+    for (; i < n; i++) max = x[i] > max ? x[i] : max;
+    return max;
+}
+
+AVX static void scaleAvx(double *x, double k, int n) {
+    __m256d factor = _mm256_set1_pd(k);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(x + i, _mm256_mul_pd(_mm256_loadu_pd(x + i), factor));
+    scaleScalar(x + i, k, n - i);
+}
+
+AVX static void axpyAvx(double *y, double a, const double *x, int n) {
+    __m256d factor = _mm256_set1_pd(a);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i),
+                                              _mm256_mul_pd(factor, _mm256_loadu_pd(x + i))));
+    }
+    axpyScalar(y + i, a, x + i, n - i);
+}
+
+AVX static void addAvx(double *y, const double *x, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(y + i, _mm256_add_pd(_mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i)));
+    addScalar(y + i, x + i, n - i);
+}
+
+AVX static void mulAvx(double *y, const double *x, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) _mm256_storeu_pd(y + i, _mm256_mul_pd(_mm256_loadu_pd(y + i), _mm256_loadu_pd(x + i)));
+    mulScalar(y + i, x + i, n - i);
+}
+
+#endif
+
+void initKernels() {
+    float64Kernels = (Float64Kernels) {
+            sumScalar, dotScalar, minScalar, maxScalar, scaleScalar,
+            axpyScalar, addScalar, mulScalar, prefixSumScalar,
+    };
+#ifdef __SSE2__
+    float64Kernels = (Float64Kernels) {
+            sumSse2, dotSse2, minSse2, maxSse2, scaleSse2,
+            axpySse2, addSse2, mulSse2, prefixSumSse2,
+    };
+#endif
+#ifdef KERNELS_AVX
+    if (__builtin_cpu_supports("avx")) {
+        // 前缀和的依赖链较长，加宽到 4 个元素收益不大，沿用当前实现
+        void (*prefixSum)(double *, int) = float64Kernels.prefixSum;
+        float64Kernels = (Float64Kernels) {
+                sumAvx, dotAvx, minAvx, maxAvx, scaleAvx,
+                axpyAvx, addAvx, mulAvx, prefixSum,
+        };
+    }
+#endif
+}
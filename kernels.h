@@ -0,0 +1,35 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#ifndef PANDA_KERNELS_H
+#define PANDA_KERNELS_H
+
+#include "common.h"
+
+// Float64Array 的数值内核，initKernels 按 CPU 支持的指令集（AVX、SSE2）选择实现
+// 向量化实现的求和顺序与逐个累加不同，结果可能有舍入误差；包含 NaN 时 min/max 的结果不确定
+typedef struct {
+    double (*sum)(const double *x, int n);
+    double (*dot)(const double *x, const double *y, int n);
+    // n 必须大于 0
+    double (*min)(const double *x, int n);
+    double (*max)(const double *x, int n);
+    // x *= k
+    void (*scale)(double *x, double k, int n);
+    // y += a * x
+    void (*axpy)(double *y, double a, const double *x, int n);
+    // y += x
+    void (*add)(double *y, const double *x, int n);
+    // y *= x
+    void (*mul)(double *y, const double *x, int n);
+    // x[i] = x[0] + ... + x[i]
+    void (*prefixSum)(double *x, int n);
+} Float64Kernels;
+
+extern Float64Kernels float64Kernels;
+
+// 检测 CPU 特性并选择内核
+void initKernels();
+
+#endif //PANDA_KERNELS_H
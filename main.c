@@ -23,8 +23,8 @@ static void repl() {
 #include <stdio.h>
 #include <stdlib.h>
 
-// 静态函数 readFile，读取指定路径的文件内容并返回一个指向该内容的指针
-static char *readFile(const char *path) {
+// 静态函数 readFile，读取指定路径的文件内容，直接读入一个由 GC 管理的字符串中
+static ObjString *readFile(const char *path) {
     // 打开文件，以二进制读模式 ("rb")
     FILE *file = fopen(path, "rb");
     // 检查文件是否成功打开，如果未成功打开则输出错误信息并退出程序
@@ -38,36 +38,27 @@ static char *readFile(const char *path) {
     size_t fileSize = ftell(file);
     // 重置文件指针到文件开头
     rewind(file);
-    // 为文件内容分配内存，+1 是为了存储结尾的 '\0' 字符
-    char *buffer = (char *) malloc(fileSize + 1);
-    // 检查内存是否成功分配，如果未成功分配则输出错误信息并退出程序
-    if (buffer == NULL) {
-        fprintf(stderr, "Not enough memory to read \"%s\".\n", path);
-        exit(74);
-    }
+    // 为文件内容分配字符串，字符串末尾自带 '\0'，编译时字面量和标识符直接引用其中的字符
+    ObjString *source = newString((int) fileSize);
     // 读取文件内容到分配的内存中
-    size_t bytesRead = fread(buffer, sizeof(char), fileSize, file);
+    size_t bytesRead = fread(source->chars, sizeof(char), fileSize, file);
     // 检查读取的字节数是否等于文件大小，如果不等则输出错误信息并退出程序
     if (bytesRead < fileSize) {
         fprintf(stderr, "Could not read file \"%s\".\n", path);
         exit(74);
     }
-    // 在读取的内容后添加 '\0' 以确保字符串的结尾
-    buffer[bytesRead] = '\0';
     // 关闭文件
     fclose(file);
-    // 返回指向读取内容的指针
-    return buffer;
+    // 返回读取到的源码
+    return source;
 }
 
 
 static void runFile(const char *path) {
     // 读取文件
-    char *source = readFile(path);
-    // 解释该文件
-    InterpretResult result = interpret(source);
-    // 释放文件内存
-    free(source);
+    ObjString *source = readFile(path);
+    // 解释该文件，源码由 GC 管理，不再被引用时自动释放
+    InterpretResult result = interpretSource(source);
     // 编译错误
     if (result == INTERPRET_COMPILE_ERROR) exit(65);
     // 解释错误
@@ -0,0 +1,198 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "map.h"
+#include "memory.h"
+#include "table.h"
+
+// 已使用的 entries 不超过索引槽位的 7/8
+#define MAP_MAX_LOAD(capacity) ((capacity) / 8 * 7)
+// entries 的容量不超过该值时不建索引
+#define MAP_INDEX_MIN 8
+// 索引的控制字节后面是 entries 的下标
+#define MAP_SLOTS(index, capacity) ((int32_t *) ((index) + (capacity)))
+#define MAP_INDEX_SIZE(capacity) ((size_t) (capacity) * (sizeof(uint8_t) + sizeof(int32_t)))
+
+// 将 64 位整数打散为 32 位哈希值
+static uint32_t mixBits(uint64_t bits) {
+    bits ^= bits >> 33;
+    bits *= 0xff51afd7ed558ccdULL;
+    bits ^= bits >> 33;
+    bits *= 0xc4ceb9fe1a85ec53ULL;
+    bits ^= bits >> 33;
+    return (uint32_t) bits;
+}
+
+// 键的哈希值：数字按数值（小整数与相等的 double 相同），字符串按内容，其余对象按地址
+static uint32_t hashKey(Value key) {
+    if (IS_NUMBER(key)) {
+        double number = AS_NUMBER(key);
+        if (isnan(number)) return mixBits(0x7ff8000000000000ULL);
+        // -0 与 +0 相等，统一为 +0
+        if (number == 0) number = 0;
+        uint64_t bits;
+        memcpy(&bits, &number, sizeof(bits));
+        return mixBits(bits);
+    }
+    if (IS_STRING(key)) return stringHash(AS_STRING(key));
+    if (IS_OBJ(key)) return mixBits((uint64_t) (uintptr_t) AS_OBJ(key));
+    return mixBits(AS_BOOL(key) ? 1 : 2);
+}
+
+static bool keysEqual(Value a, Value b) {
+    if (IS_NUMBER(a) && IS_NUMBER(b)) {
+        double x = AS_NUMBER(a);
+        double y = AS_NUMBER(b);
+        return x == y || (isnan(x) && isnan(y));
+    }
+    return valuesEqual(a, b);
+}
+
+// rope 展开后作为键，之后比较与计算哈希都不需要再分配内存；-0 存为 0
+static Value normalizeKey(Value key) {
+    if (IS_ROPE(key)) return OBJ_VAL(flattenRope(AS_ROPE(key)));
+    if (IS_NUMBER(key) && AS_NUMBER(key) == 0) return INT_VAL(0);
+    return key;
+}
+
+// 查找 key 所在的 entries 下标，找不到返回 -1，slot 中存入它在索引中的槽位
+static int findEntry(ObjMap *map, Value key, uint32_t hash, int *slot) {
+    if (map->indexCapacity == 0) {
+        for (int i = 0; i < map->entryCount; i++) {
+            MapEntry *entry = &map->entries[i];
+            if (entry->hash == hash && !IS_NIL(entry->key) && keysEqual(entry->key, key)) return i;
+        }
+        return -1;
+    }
+    uint8_t *control = map->index;
+    int32_t *slots = MAP_SLOTS(control, map->indexCapacity);
+    uint32_t groupMask = (uint32_t) (map->indexCapacity / TABLE_GROUP_SIZE - 1);
+    uint32_t group = TABLE_H1(hash) & groupMask;
+    uint8_t h2 = TABLE_H2(hash);
+    for (uint32_t step = 1;; step++) {
+        int base = (int) group * TABLE_GROUP_SIZE;
+        for (uint32_t match = tableMatchByte(control + base, h2); match != 0; match &= match - 1) {
+            int candidate = base + __builtin_ctz(match);
+            MapEntry *entry = &map->entries[slots[candidate]];
+            if (entry->hash == hash && keysEqual(entry->key, key)) {
+                *slot = candidate;
+                return slots[candidate];
+            }
+        }
+        if (tableMatchByte(control + base, TABLE_EMPTY) != 0) return -1;
+        group = (group + step) & groupMask;
+    }
+}
+
+// 将第 i 个键值对加入索引
+static void indexEntry(ObjMap *map, int i) {
+    uint32_t hash = map->entries[i].hash;
+    uint32_t groupMask = (uint32_t) (map->indexCapacity / TABLE_GROUP_SIZE - 1);
+    uint32_t group = TABLE_H1(hash) & groupMask;
+    for (uint32_t step = 1;; step++) {
+        int base = (int) group * TABLE_GROUP_SIZE;
+        uint32_t match = tableMatchFree(map->index + base);
+        if (match != 0) {
+            int slot = base + __builtin_ctz(match);
+            map->index[slot] = TABLE_H2(hash);
+            MAP_SLOTS(map->index, map->indexCapacity)[slot] = i;
+            return;
+        }
+        group = (group + step) & groupMask;
+    }
+}
+
+// 按 entries 的容量重建索引（容量不变时不分配内存）
+static void rebuildIndex(ObjMap *map) {
+    int capacity = 0;
+    if (map->entryCapacity > MAP_INDEX_MIN) {
+        capacity = TABLE_GROUP_SIZE;
+        while (MAP_MAX_LOAD(capacity) < map->entryCapacity) capacity *= 2;
+    }
+    if (capacity != map->indexCapacity) {
+        // 先分配新索引：分配可能触发 GC，此时旧索引还要能正常使用
+        uint8_t *index = capacity == 0 ? NULL : ALLOCATE(uint8_t, MAP_INDEX_SIZE(capacity));
+        if (map->index != NULL) reallocate(map->index, MAP_INDEX_SIZE(map->indexCapacity), 0);
+        map->index = index;
+        map->indexCapacity = capacity;
+    }
+    if (capacity == 0) return;
+    memset(map->index, TABLE_EMPTY, capacity);
+    for (int i = 0; i < map->entryCount; i++) {
+        if (!IS_NIL(map->entries[i].key)) indexEntry(map, i);
+    }
+}
+
+bool mapGet(ObjMap *map, Value key, Value *value) {
+    if (map->count == 0) return false;
+    key = normalizeKey(key);
+    int slot;
+    int i = findEntry(map, key, hashKey(key), &slot);
+    if (i == -1) return false;
+    *value = map->entries[i].value;
+    return true;
+}
+
+bool mapSet(ObjMap *map, Value key, Value value) {
+    key = normalizeKey(key);
+    uint32_t hash = hashKey(key);
+    int slot;
+    int i = findEntry(map, key, hash, &slot);
+    if (i != -1) {
+        map->entries[i].value = value;
+        return false;
+    }
+    if (map->entryCount == map->entryCapacity) {
+        if (map->count < map->entryCount / 2) {
+            // 一半以上是已删除的键值对：原地压缩，保持插入顺序
+            int count = 0;
+            for (int j = 0; j < map->entryCount; j++) {
+                if (!IS_NIL(map->entries[j].key)) map->entries[count++] = map->entries[j];
+            }
+            map->entryCount = count;
+        } else {
+            int capacity = GROW_CAPACITY(map->entryCapacity);
+            map->entries = GROW_ARRAY(MapEntry, map->entries, map->entryCapacity, capacity);
+            map->entryCapacity = capacity;
+        }
+        rebuildIndex(map);
+    }
+    i = map->entryCount++;
+    map->entries[i].key = key;
+    map->entries[i].value = value;
+    map->entries[i].hash = hash;
+    if (map->indexCapacity > 0) indexEntry(map, i);
+    map->count++;
+    return true;
+}
+
+bool mapDelete(ObjMap *map, Value key) {
+    if (map->count == 0) return false;
+    key = normalizeKey(key);
+    int slot;
+    int i = findEntry(map, key, hashKey(key), &slot);
+    if (i == -1) return false;
+    map->entries[i].key = NIL_VAL;
+    map->entries[i].value = NIL_VAL;
+    map->count--;
+    if (map->count == 0) {
+        // 删空后从头开始使用 entries
+        map->entryCount = 0;
+        if (map->indexCapacity > 0) memset(map->index, TABLE_EMPTY, map->indexCapacity);
+    } else if (map->indexCapacity > 0) {
+        // 与 Table 相同：组里原本就有空槽时可以直接置空，否则留下墓碑
+        int base = slot & ~(TABLE_GROUP_SIZE - 1);
+        map->index[slot] = tableMatchByte(map->index + base, TABLE_EMPTY) != 0 ? TABLE_EMPTY : TABLE_DELETED;
+    }
+    return true;
+}
+
+void freeMap(ObjMap *map) {
+    FREE_ARRAY(MapEntry, map->entries, map->entryCapacity);
+    if (map->index != NULL) reallocate(map->index, MAP_INDEX_SIZE(map->indexCapacity), 0);
+}
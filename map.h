@@ -0,0 +1,26 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#ifndef PANDA_MAP_H
+#define PANDA_MAP_H
+
+#include "common.h"
+#include "object.h"
+
+// 映射的键比较：数字按数值比较，+0 与 -0 相同，NaN 与 NaN 相同；字符串按内容比较；其余对象按地址比较
+// 键为 rope 时会先展开（可能触发 GC），调用方需要保证键与值在栈上
+
+// 查找 key，找到时将值存入 value
+bool mapGet(ObjMap *map, Value key, Value *value);
+
+// 插入或覆盖，新增键值对时返回 true（key 不能为 nil）
+bool mapSet(ObjMap *map, Value key, Value value);
+
+// 删除 key，存在时返回 true
+bool mapDelete(ObjMap *map, Value key);
+
+// 释放键值对数组与索引（不释放映射对象本身）
+void freeMap(ObjMap *map);
+
+#endif //PANDA_MAP_H
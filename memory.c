@@ -3,8 +3,17 @@
 //
 
 #include <stdlib.h>
+#include <sys/mman.h>
 #include "memory.h"
 #include "vm.h"
+#include "native.h"
+#include "map.h"
+
+#ifdef POINTER_COMPRESSION
+
+#include <string.h>
+
+#endif
 
 #ifdef DEBUG_LOG_GC
 
@@ -14,8 +23,8 @@
 #endif
 #define GC_HEAP_GROW_FACTOR 2
 
-// 重新分配内存，返回新的地址
-void *reallocate(void *pointer, size_t oldSize, size_t newSize) {
+// 记录分配的字节数，必要时触发垃圾回收
+static void trackAllocation(size_t oldSize, size_t newSize) {
     vm.bytesAllocated += newSize - oldSize;
     // 垃圾回收
     // 如果新内存大于旧内存，说明发生了新的内存分配、累积到大于nextGC值，则触发垃圾回收
@@ -28,6 +37,11 @@ void *reallocate(void *pointer, size_t oldSize, size_t newSize) {
             collectGarbage();
         }
     }
+}
+
+// 重新分配内存，返回新的地址
+void *reallocate(void *pointer, size_t oldSize, size_t newSize) {
+    trackAllocation(oldSize, newSize);
     if (newSize == 0) {
         free(pointer);
         return NULL;
@@ -38,16 +52,103 @@ void *reallocate(void *pointer, size_t oldSize, size_t newSize) {
     return result;
 }
 
+#ifdef POINTER_COMPRESSION
+
+// 堆笼大小，32 位偏移能表示的范围
+#define HEAP_CAGE_SIZE ((size_t) 1 << 32)
+// 最小的块为 16 字节（2^4），块大小按 2 的幂分级
+#define CAGE_MIN_CLASS 4
+#define CAGE_CLASS_COUNT 33
+// 不小于该大小的块释放时将物理页归还给系统
+#define CAGE_RELEASE_SIZE (64 * 1024)
+
+char *heapCage = NULL;
+// 堆笼中尚未使用过的部分的起始偏移
+static size_t cageTop;
+// 每个大小等级的空闲块链表，空闲块的前 8 字节存放下一个空闲块
+static void *cageFreeLists[CAGE_CLASS_COUNT];
+
+// 返回能容纳 size 字节的最小大小等级
+static int cageSizeClass(size_t size) {
+    int sizeClass = CAGE_MIN_CLASS;
+    while (((size_t) 1 << sizeClass) < size) sizeClass++;
+    return sizeClass;
+}
+
+void initHeapCage() {
+    // 只预留地址空间，物理内存在第一次写入时才会分配
+    void *base = mmap(NULL, HEAP_CAGE_SIZE, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (base == MAP_FAILED) exit(1);
+    heapCage = (char *) base;
+    // 偏移 0 保留给 NULL
+    cageTop = (size_t) 1 << CAGE_MIN_CLASS;
+    for (int i = 0; i < CAGE_CLASS_COUNT; i++) {
+        cageFreeLists[i] = NULL;
+    }
+}
+
+void freeHeapCage() {
+    munmap(heapCage, HEAP_CAGE_SIZE);
+    heapCage = NULL;
+}
+
+// 将块放回对应大小等级的空闲链表
+static void cageFree(void *pointer, size_t size) {
+    int sizeClass = cageSizeClass(size);
+    if (size >= CAGE_RELEASE_SIZE) {
+        madvise(pointer, (size_t) 1 << sizeClass, MADV_DONTNEED);
+    }
+    *(void **) pointer = cageFreeLists[sizeClass];
+    cageFreeLists[sizeClass] = pointer;
+}
+
+// 从堆笼中分配一块能容纳 size 字节的内存
+static void *cageAllocate(size_t size) {
+    int sizeClass = cageSizeClass(size);
+    void *result = cageFreeLists[sizeClass];
+    if (result != NULL) {
+        cageFreeLists[sizeClass] = *(void **) result;
+        return result;
+    }
+    // 没有空闲块，从未使用的部分切出一块，块按自身大小对齐（最多按页对齐）
+    size_t blockSize = (size_t) 1 << sizeClass;
+    size_t align = blockSize < 4096 ? blockSize : 4096;
+    size_t offset = (cageTop + align - 1) & ~(align - 1);
+    // 堆笼已满
+    if (offset + blockSize > HEAP_CAGE_SIZE) exit(1);
+    cageTop = offset + blockSize;
+    return heapCage + offset;
+}
+
+void *reallocateObject(void *pointer, size_t oldSize, size_t newSize) {
+    trackAllocation(oldSize, newSize);
+    if (newSize == 0) {
+        // 与 free 一样允许释放 NULL
+        if (pointer != NULL) cageFree(pointer, oldSize);
+        return NULL;
+    }
+    if (pointer == NULL) return cageAllocate(newSize);
+    // 大小等级不变时原地调整
+    if (cageSizeClass(oldSize) == cageSizeClass(newSize)) return pointer;
+    void *result = cageAllocate(newSize);
+    memcpy(result, pointer, oldSize < newSize ? oldSize : newSize);
+    cageFree(pointer, oldSize);
+    return result;
+}
+
+#endif
+
 void markObject(Obj *object) {
     if (object == NULL) return;
-    if (object->isMarked) return;
+    if (OBJ_IS_MARKED(object)) return;
 #ifdef DEBUG_LOG_GC
     printf("%p mark ", (void *) object);
     printValue(OBJ_VAL(object));
     printf("\n");
 #endif
     // 标记
-    object->isMarked = true;
+    OBJ_SET_MARKED(object);
     // 将标记后的对象地址加入到灰色栈中
     if (vm.grayCapacity < vm.grayCount + 1) {
         vm.grayCapacity = GROW_CAPACITY(vm.grayCapacity);
@@ -79,24 +180,25 @@ static void blackenObject(Obj *object) {
     printValue(OBJ_VAL(object));
     printf("\n");
 #endif
-    switch (object->type) {
+    switch (OBJ_HEADER_TYPE(object)) {
         case OBJ_BOUND_METHOD: {
             ObjBoundMethod *bound = (ObjBoundMethod *) object;
             markValue(bound->receiver);
-            markObject((Obj *) bound->method);
+            markObject((Obj *) BOUND_METHOD(bound));
             break;
         }
         case OBJ_CLASS: {
             ObjClass *klass = (ObjClass *) object;
             markObject((Obj *) klass->name);
             markTable(&klass->methods);
+            markObject((Obj *) klass->superclass);
             break;
         }
         case OBJ_CLOSURE: {
             ObjClosure *closure = (ObjClosure *) object;
             markObject((Obj *) closure->function);
             for (int i = 0; i < closure->upvalueCount; i++) {
-                markObject((Obj *) closure->upvalues[i]);
+                markObject((Obj *) CLOSURE_UPVALUE(closure, i));
             }
             break;
         }
@@ -108,66 +210,132 @@ static void blackenObject(Obj *object) {
         }
         case OBJ_INSTANCE: {
             ObjInstance *instance = (ObjInstance *) object;
-            markObject((Obj *) instance->klass);
+            markObject((Obj *) INSTANCE_CLASS(instance));
             markTable(&instance->fields);
             break;
         }
+        case OBJ_ROPE: {
+            ObjRope *rope = (ObjRope *) object;
+            markObject(rope->left);
+            markObject(rope->right);
+            markObject((Obj *) rope->flat);
+            break;
+        }
         case OBJ_UPVALUE:
             markValue(((ObjUpvalue *) object)->closed);
             break;
-        case OBJ_NATIVE:
         case OBJ_STRING:
+            // 外部字符串需要保证持有字符的对象存活
+            if (STRING_IS_EXTERNAL((ObjString *) object)) {
+                markObject(((ObjExternalString *) object)->owner);
+            }
+            break;
+        case OBJ_LIST:
+            markArray(&((ObjList *) object)->items);
+            break;
+        case OBJ_BYTES:
+            markObject(((ObjBytes *) object)->owner);
+            break;
+        case OBJ_MAP: {
+            // 已删除的键值对为 nil，标记也没有影响
+            ObjMap *map = (ObjMap *) object;
+            for (int i = 0; i < map->entryCount; i++) {
+                markValue(map->entries[i].key);
+                markValue(map->entries[i].value);
+            }
+            break;
+        }
+        case OBJ_NATIVE:
+        case OBJ_STRING_BUILDER:
+        case OBJ_TYPED_ARRAY:
             break;
     }
 }
 
 static void freeObject(Obj *object) {
 #ifdef DEBUG_LOG_GC
-    printf("%p free type %d\n", (void *) object, object->type);
+    printf("%p free type %d\n", (void *) object, OBJ_HEADER_TYPE(object));
 #endif
-    switch (object->type) {
+    switch (OBJ_HEADER_TYPE(object)) {
 
         case OBJ_BOUND_METHOD:
-            FREE(ObjBoundMethod, object);
+            FREE_OBJ(ObjBoundMethod, object);
             break;
         case OBJ_CLASS: {
             ObjClass *klass = (ObjClass *) object;
             freeTable(&klass->methods);
-            FREE(ObjClass, object);
+            FREE_OBJ(ObjClass, object);
             break;
         }
             // 释放闭包对象
         case OBJ_CLOSURE: {
             ObjClosure *closure = (ObjClosure *) object;
-            FREE_ARRAY(ObjUpvalue*, closure->upvalues, closure->upvalueCount);
-            FREE(ObjClosure, object);
+            FREE_ARRAY(REF(ObjUpvalue), closure->upvalues, closure->upvalueCount);
+            FREE_OBJ(ObjClosure, object);
             break;
         }
             // 释放函数内存
         case OBJ_FUNCTION: {
             ObjFunction *function = (ObjFunction *) object;
             freeChunk(&function->chunk);
-            FREE(ObjFunction, object);
+            FREE_OBJ(ObjFunction, object);
             break;
         }
         case OBJ_INSTANCE: {
             ObjInstance *instance = (ObjInstance *) object;
             freeTable(&instance->fields);
-            FREE(ObjInstance, object);
+            FREE_OBJ(ObjInstance, object);
             break;
         }
             // 释放本地函数（C 语言函数）
         case OBJ_NATIVE:
-            FREE(ObjNative, object);
+            FREE_OBJ(ObjNative, object);
+            break;
+        case OBJ_ROPE:
+            FREE_OBJ(ObjRope, object);
             break;
         case OBJ_STRING: {
             ObjString *string = (ObjString *) object;
-            FREE_ARRAY(char, string->chars, string->length + 1);
-            FREE(ObjString, object);
+            // 驻留的字符串在释放时从驻留集合中移除，不需要在标记后扫描整个集合
+            if (STRING_IS_INTERNED(string)) stringSetRemove(&vm.strings, string);
+            if (STRING_IS_EXTERNAL(string)) {
+                FREE_OBJ(ObjExternalString, object);
+            } else {
+                reallocateObject(object, sizeof(ObjString) + string->length + 1, 0);
+            }
+            break;
+        }
+        case OBJ_LIST:
+            freeValueArray(&((ObjList *) object)->items);
+            FREE_OBJ(ObjList, object);
+            break;
+        case OBJ_BYTES: {
+            ObjBytes *bytes = (ObjBytes *) object;
+            if (bytes->storage == BYTES_OWNED) {
+                FREE_ARRAY(uint8_t, bytes->data, bytes->length);
+            } else if (bytes->storage == BYTES_MAPPED) {
+                munmap(bytes->data, bytes->length);
+            }
+            FREE_OBJ(ObjBytes, object);
+            break;
+        }
+        case OBJ_MAP:
+            freeMap((ObjMap *) object);
+            FREE_OBJ(ObjMap, object);
+            break;
+        case OBJ_TYPED_ARRAY: {
+            ObjTypedArray *array = (ObjTypedArray *) object;
+            reallocateObject(object, sizeof(ObjTypedArray) + typedArrayElementSize(array->type) * array->length, 0);
+            break;
+        }
+        case OBJ_STRING_BUILDER: {
+            ObjStringBuilder *builder = (ObjStringBuilder *) object;
+            reallocateStringBuffer(builder->chars, builder->capacity, 0);
+            FREE_OBJ(ObjStringBuilder, object);
             break;
         }
         case OBJ_UPVALUE:
-            FREE(ObjUpvalue, object);
+            FREE_OBJ(ObjUpvalue, object);
             break;
     }
 }
@@ -192,6 +360,8 @@ static void markRoots() {
     markCompilerRoots();
     // 标记初始化字符串对象（init）
     markObject((Obj *) vm.initString);
+    // 标记内置方法名称
+    markNativeMethods();
 }
 
 static void traceReferences() {
@@ -205,15 +375,15 @@ static void sweep() {
     Obj *previous = NULL;
     Obj *object = vm.objects;
     while (object != NULL) {
-        if (object->isMarked) {
-            object->isMarked = false;
+        if (OBJ_IS_MARKED(object)) {
+            OBJ_CLEAR_MARKED(object);
             previous = object;
-            object = object->next;
+            object = OBJ_NEXT(object);
         } else {
             Obj *unreached = object;
-            object = object->next;
+            object = OBJ_NEXT(object);
             if (previous != NULL) {
-                previous->next = object;
+                OBJ_SET_NEXT(previous, object);
             } else {
                 vm.objects = object;
             }
@@ -233,8 +403,6 @@ void collectGarbage() {
     //
     traceReferences();
     //
-    tableRemoveWhite(&vm.strings);
-    //
     sweep();
     //
     vm.nextGC = vm.bytesAllocated * GC_HEAP_GROW_FACTOR;
@@ -251,7 +419,7 @@ void collectGarbage() {
 void freeObjects() {
     Obj *object = vm.objects;
     while (object != NULL) {
-        Obj *next = object->next;
+        Obj *next = OBJ_NEXT(object);
         freeObject(object);
         object = next;
     }
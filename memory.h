@@ -16,6 +16,9 @@
 
 #define FREE(type, pointer) reallocate(pointer, sizeof(type), 0)
 
+// 释放对象本身（开启指针压缩时对象位于堆笼中）
+#define FREE_OBJ(type, pointer) reallocateObject(pointer, sizeof(type), 0)
+
 // 2 倍扩容，返回容量
 #define GROW_CAPACITY(capacity) ((capacity) < 8 ? 8 : (capacity) * 2)
 
@@ -28,6 +31,24 @@
 // 重新分配内存函数，为 0 则代表释放内存
 void *reallocate(void *pointer, size_t oldSize, size_t newSize);
 
+#ifdef POINTER_COMPRESSION
+
+// 预留堆笼的虚拟地址空间
+void initHeapCage();
+
+// 归还堆笼
+void freeHeapCage();
+
+// 在堆笼中分配、调整或释放对象内存
+void *reallocateObject(void *pointer, size_t oldSize, size_t newSize);
+
+#else
+
+// 未开启指针压缩时，对象与其他内存一样分配
+#define reallocateObject reallocate
+
+#endif
+
 void markObject(Obj *object);
 
 void markValue(Value value);
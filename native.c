@@ -0,0 +1,962 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#include "native.h"
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "memory.h"
+#include "vm.h"
+#include "map.h"
+#include "kernels.h"
+#include "sort.h"
+#include "json.h"
+
+// 内置方法表项：名称在 initNativeMethods 中驻留，查找时只比较指针
+typedef struct {
+    const char *name;
+    NativeMethod method;
+    ObjString *nameString;
+} NativeMethodEntry;
+
+// 保证构建器至少还能写入 count 个字符
+static void ensureCapacity(ObjStringBuilder *builder, int count) {
+    if (builder->length + count <= builder->capacity) return;
+    int capacity = GROW_CAPACITY(builder->capacity);
+    if (capacity < builder->length + count) capacity = builder->length + count;
+    builder->chars = reallocateStringBuffer(builder->chars, builder->capacity, capacity);
+    builder->capacity = capacity;
+}
+
+static void appendChars(ObjStringBuilder *builder, const char *chars, int length) {
+    ensureCapacity(builder, length);
+    memcpy(builder->chars + builder->length, chars, length);
+    builder->length += length;
+}
+
+// append(string)：追加字符串，返回构建器本身
+static bool builderAppend(int argCount, Value *args) {
+    if (argCount != 1 || !IS_ANY_STRING(args[1])) {
+        runtimeError("append() expects a string.");
+        return false;
+    }
+    // 展开 rope 可能触发 GC，参数仍在栈上
+    ObjString *string = IS_ROPE(args[1]) ? flattenRope(AS_ROPE(args[1])) : AS_STRING(args[1]);
+    appendChars(AS_STRING_BUILDER(args[0]), string->chars, string->length);
+    return true;
+}
+
+// appendNumber(number)：按 print 的格式追加数字，不创建中间字符串
+static bool builderAppendNumber(int argCount, Value *args) {
+    if (argCount != 1 || !IS_NUMBER(args[1])) {
+        runtimeError("appendNumber() expects a number.");
+        return false;
+    }
+    char buffer[NUMBER_BUFFER_SIZE];
+    int length = formatNumber(args[1], buffer);
+    appendChars(AS_STRING_BUILDER(args[0]), buffer, length);
+    return true;
+}
+
+// reserve(n)：预留 n 个字符的空间，返回构建器本身
+static bool builderReserve(int argCount, Value *args) {
+    // 写成 !(0 <= n <= INT32_MAX)，NaN 在转换为 int 之前就被拒绝
+    if (argCount != 1 || !IS_NUMBER(args[1]) || !(AS_NUMBER(args[1]) >= 0 && AS_NUMBER(args[1]) <= INT32_MAX)) {
+        runtimeError("reserve() expects a non-negative number.");
+        return false;
+    }
+    ObjStringBuilder *builder = AS_STRING_BUILDER(args[0]);
+    int count = (int) AS_NUMBER(args[1]);
+    if (count > builder->capacity) {
+        builder->chars = reallocateStringBuffer(builder->chars, builder->capacity, count);
+        builder->capacity = count;
+    }
+    return true;
+}
+
+// toString()：交出缓冲区作为字符串，构建器清空
+static bool builderToString(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d.", argCount);
+        return false;
+    }
+    ObjStringBuilder *builder = AS_STRING_BUILDER(args[0]);
+    ObjString *string = takeString(builder->chars, builder->length, builder->capacity);
+    builder->chars = NULL;
+    builder->length = 0;
+    builder->capacity = 0;
+    args[0] = OBJ_VAL(string);
+    return true;
+}
+
+// length()：已写入的字符数
+static bool builderLength(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d.", argCount);
+        return false;
+    }
+    args[0] = INT_VAL(AS_STRING_BUILDER(args[0])->length);
+    return true;
+}
+
+// 字符串参数（展开 rope，展开结果缓存在 rope 中，随参数一起存活）
+static ObjString *asFlatString(Value value) {
+    return IS_ROPE(value) ? flattenRope(AS_ROPE(value)) : AS_STRING(value);
+}
+
+// 整数参数
+static bool asIndex(Value value, int *index) {
+    if (!IS_NUMBER(value)) return false;
+    double number = AS_NUMBER(value);
+    // NaN、无穷和超出 int 的值不能直接转换，先检查范围
+    if (!(number >= INT32_MIN && number <= INT32_MAX) || number != (int) number) return false;
+    *index = (int) number;
+    return true;
+}
+
+// 在 haystack 的 [start, length) 中查找 needle，返回下标，找不到返回 -1
+static int findChars(const char *haystack, int length, const char *needle, int needleLength, int start) {
+    int last = length - needleLength;
+    if (start > last) return -1;
+    if (needleLength == 0) return start;
+    if (needleLength == 1) {
+        const char *found = memchr(haystack + start, needle[0], length - start);
+        return found == NULL ? -1 : (int) (found - haystack);
+    }
+    int i = start;
+#ifdef __SSE2__
+    // 一次检查 16 个位置：首字符与尾字符都相同的位置才逐字节比较
+    __m128i first = _mm_set1_epi8(needle[0]);
+    __m128i tail = _mm_set1_epi8(needle[needleLength - 1]);
+    for (; i + 16 <= last + 1; i += 16) {
+        __m128i blockFirst = _mm_loadu_si128((const __m128i *) (haystack + i));
+        __m128i blockTail = _mm_loadu_si128((const __m128i *) (haystack + i + needleLength - 1));
+        unsigned mask = (unsigned) _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst),
+                                                                   _mm_cmpeq_epi8(tail, blockTail)));
+        while (mask != 0) {
+            int offset = __builtin_ctz(mask);
+            if (memcmp(haystack + i + offset + 1, needle + 1, needleLength - 2) == 0) return i + offset;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i <= last; i++) {
+        const char *found = memchr(haystack + i, needle[0], last - i + 1);
+        if (found == NULL) return -1;
+        i = (int) (found - haystack);
+        if (memcmp(found + 1, needle + 1, needleLength - 1) == 0) return i;
+    }
+    return -1;
+}
+
+// length()：字符数
+static bool stringLength(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d.", argCount);
+        return false;
+    }
+    args[0] = INT_VAL(asFlatString(args[0])->length);
+    return true;
+}
+
+// find(sub[, start])：返回 sub 第一次出现的下标，找不到返回 -1
+static bool stringFind(int argCount, Value *args) {
+    int start = 0;
+    if (argCount < 1 || argCount > 2 || !IS_ANY_STRING(args[1]) ||
+        (argCount == 2 && (!asIndex(args[2], &start) || start < 0))) {
+        runtimeError("find() expects a string and an optional start index.");
+        return false;
+    }
+    ObjString *string = asFlatString(args[0]);
+    ObjString *needle = asFlatString(args[1]);
+    int index = findChars(string->chars, string->length, needle->chars, needle->length, start);
+    args[0] = INT_VAL(index);
+    return true;
+}
+
+// substring(start[, end])：返回 [start, end) 的子串，较长的子串不拷贝字符
+static bool stringSubstring(int argCount, Value *args) {
+    int start = 0;
+    int end = 0;
+    if (argCount < 1 || argCount > 2 || !asIndex(args[1], &start) ||
+        (argCount == 2 && !asIndex(args[2], &end))) {
+        runtimeError("substring() expects a start and an optional end index.");
+        return false;
+    }
+    ObjString *string = asFlatString(args[0]);
+    if (argCount == 1) end = string->length;
+    if (start < 0 || end > string->length || start > end) {
+        runtimeError("Substring range %d..%d out of bounds for length %d.", start, end, string->length);
+        return false;
+    }
+    if (start == 0 && end == string->length) {
+        args[0] = OBJ_VAL(string);
+        return true;
+    }
+    args[0] = OBJ_VAL(substring(string, start, end - start));
+    return true;
+}
+
+// replace(old, new)：替换所有出现的 old，没有出现时返回原字符串
+static bool stringReplace(int argCount, Value *args) {
+    if (argCount != 2 || !IS_ANY_STRING(args[1]) || !IS_ANY_STRING(args[2])) {
+        runtimeError("replace() expects two strings.");
+        return false;
+    }
+    ObjString *string = asFlatString(args[0]);
+    ObjString *from = asFlatString(args[1]);
+    ObjString *to = asFlatString(args[2]);
+    if (from->length == 0) {
+        runtimeError("Cannot replace an empty string.");
+        return false;
+    }
+    // 先数出现次数，结果只分配一次
+    int count = 0;
+    for (int i = findChars(string->chars, string->length, from->chars, from->length, 0); i != -1;
+         i = findChars(string->chars, string->length, from->chars, from->length, i + from->length)) {
+        count++;
+    }
+    if (count == 0) {
+        args[0] = OBJ_VAL(string);
+        return true;
+    }
+    int64_t length = string->length + (int64_t) count * (to->length - from->length);
+    if (length > INT32_MAX) {
+        runtimeError("String too long.");
+        return false;
+    }
+    char *chars = allocateStringBuffer((int) length);
+    int written = 0;
+    int copied = 0;
+    for (int i = findChars(string->chars, string->length, from->chars, from->length, 0); i != -1;
+         i = findChars(string->chars, string->length, from->chars, from->length, i + from->length)) {
+        memcpy(chars + written, string->chars + copied, i - copied);
+        written += i - copied;
+        memcpy(chars + written, to->chars, to->length);
+        written += to->length;
+        copied = i + from->length;
+    }
+    memcpy(chars + written, string->chars + copied, string->length - copied);
+    args[0] = OBJ_VAL(takeString(chars, (int) length, (int) length));
+    return true;
+}
+
+// split(separator)：按 separator 拆分为列表，较长的部分不拷贝字符
+static bool stringSplit(int argCount, Value *args) {
+    if (argCount != 1 || !IS_ANY_STRING(args[1])) {
+        runtimeError("split() expects a string.");
+        return false;
+    }
+    ObjString *string = asFlatString(args[0]);
+    ObjString *separator = asFlatString(args[1]);
+    if (separator->length == 0) {
+        runtimeError("Cannot split on an empty string.");
+        return false;
+    }
+    // 先数出分段数，列表只分配一次
+    int count = 1;
+    for (int i = findChars(string->chars, string->length, separator->chars, separator->length, 0); i != -1;
+         i = findChars(string->chars, string->length, separator->chars, separator->length, i + separator->length)) {
+        count++;
+    }
+    ObjList *list = newList(count);
+    // 创建子串可能触发 GC：接收者仍在栈上，列表暂时入栈，元素数量随写入增加
+    push(OBJ_VAL(list));
+    int start = 0;
+    for (int i = 0; i < count; i++) {
+        int end = i == count - 1 ? string->length
+                                 : findChars(string->chars, string->length, separator->chars, separator->length, start);
+        list->items.values[i] = OBJ_VAL(substring(string, start, end - start));
+        list->items.count++;
+        start = end + separator->length;
+    }
+    args[0] = pop();
+    return true;
+}
+
+// append(value)：在末尾追加元素
+static bool listAppend(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d.", argCount);
+        return false;
+    }
+    writeValueArray(&AS_LIST(args[0])->items, args[1]);
+    args[0] = NIL_VAL;
+    return true;
+}
+
+// pop()：移除并返回最后一个元素
+static bool listPop(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d.", argCount);
+        return false;
+    }
+    ObjList *list = AS_LIST(args[0]);
+    if (list->items.count == 0) {
+        runtimeError("Cannot pop from an empty list.");
+        return false;
+    }
+    args[0] = list->items.values[--list->items.count];
+    return true;
+}
+
+// length()：元素数量
+static bool listLength(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d.", argCount);
+        return false;
+    }
+    args[0] = INT_VAL(AS_LIST(args[0])->items.count);
+    return true;
+}
+
+// sort([comparator])：原地排序，comparator(a, b) 返回负数表示 a 应排在 b 前面
+static bool listSort(int argCount, Value *args) {
+    if (argCount > 1) {
+        runtimeError("Expected 0 or 1 arguments but got %d.", argCount);
+        return false;
+    }
+    if (!sortList(AS_LIST(args[0]), argCount == 1 ? args[1] : NIL_VAL)) return false;
+    args[0] = NIL_VAL;
+    return true;
+}
+
+// length()：键值对数量
+static bool mapLength(int argCount, Value *args) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d.", argCount);
+        return false;
+    }
+    args[0] = INT_VAL(AS_MAP(args[0])->count);
+    return true;
+}
+
+// has(key)：是否存在 key
+static bool mapHas(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d.", argCount);
+        return false;
+    }
+    Value value;
+    args[0] = BOOL_VAL(mapGet(AS_MAP(args[0]), args[1], &value));
+    return true;
+}
+
+// remove(key)：删除 key，返回是否存在
+static bool mapRemove(int argCount, Value *args) {
+    if (argCount != 1) {
+        runtimeError("Expected 1 argument but got %d.", argCount);
+        return false;
+    }
+    args[0] = BOOL_VAL(mapDelete(AS_MAP(args[0]), args[1]));
+    return true;
+}
+
+// 按插入顺序将键（或值）收集到列表中
+static bool mapCollect(int argCount, Value *args, bool keys) {
+    if (argCount != 0) {
+        runtimeError("Expected 0 arguments but got %d.", argCount);
+        return false;
+    }
+    ObjMap *map = AS_MAP(args[0]);
+    ObjList *list = newList(map->count);
+    for (int i = 0; i < map->entryCount; i++) {
+        MapEntry *entry = &map->entries[i];
+        if (IS_NIL(entry->key)) continue;
+        list->items.values[list->items.count++] = keys ? entry->key : entry->value;
+    }
+    args[0] = OBJ_VAL(list);
+    return true;
+}
+
+// keys()：所有键组成的列表
+static bool mapKeys(int argCount, Value *args) {
+    return mapCollect(argCount, args, true);
+}
+
+// values()：所有值组成的列表
+static bool mapValues(int argCount, Value *args) {
+    return mapCollect(argCount, args, false);
+}
+
+// 数值数组的第 i 个元素（整数数组的逐个计算使用）
+static double elementAt(ObjTypedArray *array, int i) {
+    switch (array->type) {
+        case TYPED_FLOAT64:
+            return TYPED_ARRAY_FLOAT64(array)[i];
+        case TYPED_INT32:
+            return TYPED_ARRAY_INT32(array)[i];
+        case TYPED_UINT8:
+            return TYPED_ARRAY_UINT8(array)[i];
+    }
+    return 0; // Unreachable.
+}
+
+static bool expectArguments(int argCount, int expected) {
+    if (argCount != expected) {
+        runtimeError("Expected %d argument%s but got %d.", expected, expected == 1 ? "" : "s", argCount);
+        return false;
+    }
+    return true;
+}
+
+// 另一个参与运算的数组：类型与长度必须与接收者相同
+static ObjTypedArray *operandArray(ObjTypedArray *array, Value value, const char *method) {
+    if (!IS_TYPED_ARRAY(value) || AS_TYPED_ARRAY(value)->type != array->type ||
+        AS_TYPED_ARRAY(value)->length != array->length) {
+        runtimeError("%s() expects an array of the same type and length.", method);
+        return NULL;
+    }
+    return AS_TYPED_ARRAY(value);
+}
+
+// length()：元素数量
+static bool typedArrayLength(int argCount, Value *args) {
+    if (!expectArguments(argCount, 0)) return false;
+    args[0] = INT_VAL(AS_TYPED_ARRAY(args[0])->length);
+    return true;
+}
+
+// sum()：所有元素的和
+static bool typedArraySum(int argCount, Value *args) {
+    if (!expectArguments(argCount, 0)) return false;
+    ObjTypedArray *array = AS_TYPED_ARRAY(args[0]);
+    double sum = 0;
+    if (array->type == TYPED_FLOAT64) {
+        sum = float64Kernels.sum(TYPED_ARRAY_FLOAT64(array), array->length);
+    } else {
+        for (int i = 0; i < array->length; i++) sum += elementAt(array, i);
+    }
+    args[0] = NUMBER_VAL(sum);
+    return true;
+}
+
+// min() / max()：最小（最大）的元素，数组不能为空
+static bool typedArrayExtreme(int argCount, Value *args, bool max) {
+    if (!expectArguments(argCount, 0)) return false;
+    ObjTypedArray *array = AS_TYPED_ARRAY(args[0]);
+    if (array->length == 0) {
+        runtimeError("%s() of an empty array.", max ? "max" : "min");
+        return false;
+    }
+    if (array->type == TYPED_FLOAT64) {
+        double *x = TYPED_ARRAY_FLOAT64(array);
+        args[0] = NUMBER_VAL(max ? float64Kernels.max(x, array->length) : float64Kernels.min(x, array->length));
+        return true;
+    }
+    int found = 0;
+    for (int i = 1; i < array->length; i++) {
+        double value = elementAt(array, i);
+        if (max ? value > elementAt(array, found) : value < elementAt(array, found)) found = i;
+    }
+    args[0] = typedArrayGet(array, found);
+    return true;
+}
+
+static bool typedArrayMin(int argCount, Value *args) {
+    return typedArrayExtreme(argCount, args, false);
+}
+
+static bool typedArrayMax(int argCount, Value *args) {
+    return typedArrayExtreme(argCount, args, true);
+}
+
+// dot(other)：点积
+static bool typedArrayDot(int argCount, Value *args) {
+    if (!expectArguments(argCount, 1)) return false;
+    ObjTypedArray *array = AS_TYPED_ARRAY(args[0]);
+    ObjTypedArray *other = operandArray(array, args[1], "dot");
+    if (other == NULL) return false;
+    double sum = 0;
+    if (array->type == TYPED_FLOAT64) {
+        sum = float64Kernels.dot(TYPED_ARRAY_FLOAT64(array), TYPED_ARRAY_FLOAT64(other), array->length);
+    } else {
+        for (int i = 0; i < array->length; i++) sum += elementAt(array, i) * elementAt(other, i);
+    }
+    args[0] = NUMBER_VAL(sum);
+    return true;
+}
+
+// scale(k)：每个元素乘以 k，返回数组本身
+static bool typedArrayScale(int argCount, Value *args) {
+    if (!expectArguments(argCount, 1)) return false;
+    if (!IS_NUMBER(args[1])) {
+        runtimeError("scale() expects a number.");
+        return false;
+    }
+    ObjTypedArray *array = AS_TYPED_ARRAY(args[0]);
+    double k = AS_NUMBER(args[1]);
+    if (array->type == TYPED_FLOAT64) {
+        float64Kernels.scale(TYPED_ARRAY_FLOAT64(array), k, array->length);
+    } else {
+        for (int i = 0; i < array->length; i++) typedArraySet(array, i, elementAt(array, i) * k);
+    }
+    return true;
+}
+
+// axpy(a, x)：this += a * x，返回数组本身
+static bool typedArrayAxpy(int argCount, Value *args) {
+    if (!expectArguments(argCount, 2)) return false;
+    if (!IS_NUMBER(args[1])) {
+        runtimeError("axpy() expects a number and an array.");
+        return false;
+    }
+    ObjTypedArray *array = AS_TYPED_ARRAY(args[0]);
+    ObjTypedArray *x = operandArray(array, args[2], "axpy");
+    if (x == NULL) return false;
+    double a = AS_NUMBER(args[1]);
+    if (array->type == TYPED_FLOAT64) {
+        float64Kernels.axpy(TYPED_ARRAY_FLOAT64(array), a, TYPED_ARRAY_FLOAT64(x), array->length);
+    } else {
+        for (int i = 0; i < array->length; i++) typedArraySet(array, i, elementAt(array, i) + a * elementAt(x, i));
+    }
+    return true;
+}
+
+// add(other) / mul(other)：逐个元素相加（相乘），结果写回接收者，返回数组本身
+static bool typedArrayElementwise(int argCount, Value *args, bool multiply) {
+    if (!expectArguments(argCount, 1)) return false;
+    ObjTypedArray *array = AS_TYPED_ARRAY(args[0]);
+    ObjTypedArray *other = operandArray(array, args[1], multiply ? "mul" : "add");
+    if (other == NULL) return false;
+    if (array->type == TYPED_FLOAT64) {
+        double *y = TYPED_ARRAY_FLOAT64(array);
+        double *x = TYPED_ARRAY_FLOAT64(other);
+        if (multiply) {
+            float64Kernels.mul(y, x, array->length);
+        } else {
+            float64Kernels.add(y, x, array->length);
+        }
+        return true;
+    }
+    for (int i = 0; i < array->length; i++) {
+        double a = elementAt(array, i);
+        double b = elementAt(other, i);
+        typedArraySet(array, i, multiply ? a * b : a + b);
+    }
+    return true;
+}
+
+static bool typedArrayAdd(int argCount, Value *args) {
+    return typedArrayElementwise(argCount, args, false);
+}
+
+static bool typedArrayMul(int argCount, Value *args) {
+    return typedArrayElementwise(argCount, args, true);
+}
+
+// prefixSum()：原地计算前缀和，返回数组本身
+static bool typedArrayPrefixSum(int argCount, Value *args) {
+    if (!expectArguments(argCount, 0)) return false;
+    ObjTypedArray *array = AS_TYPED_ARRAY(args[0]);
+    if (array->type == TYPED_FLOAT64) {
+        float64Kernels.prefixSum(TYPED_ARRAY_FLOAT64(array), array->length);
+    } else {
+        for (int i = 1; i < array->length; i++) typedArraySet(array, i, elementAt(array, i - 1) + elementAt(array, i));
+    }
+    return true;
+}
+
+// 字节缓冲区中 [start, end) 的范围参数，从 args[first] 开始，省略时为整个缓冲区
+static bool bytesRange(ObjBytes *bytes, int argCount, Value *args, int first, int *start, int *end,
+                       const char *method) {
+    *start = 0;
+    *end = bytes->length;
+    if ((argCount >= first && !asIndex(args[first], start)) ||
+        (argCount >= first + 1 && !asIndex(args[first + 1], end)) || argCount > first + 1) {
+        runtimeError("%s() expects an optional start and end index.", method);
+        return false;
+    }
+    if (*start < 0 || *end > bytes->length || *start > *end) {
+        runtimeError("Range %d..%d out of bounds for length %d.", *start, *end, bytes->length);
+        return false;
+    }
+    return true;
+}
+
+// 按 size 个字节读写整数或浮点数，最后一个可选参数为 true 时按小端序，否则按大端序（与 DataView 相同）
+// isSigned 只对整数有意义，浮点数传 false
+static bool bytesAccess(int argCount, Value *args, int size, bool isSigned, bool isFloat, bool set,
+                        const char *method) {
+    ObjBytes *bytes = AS_BYTES(args[0]);
+    int required = set ? 2 : 1;
+    int offset;
+    if (argCount < required || argCount > required + 1 || !asIndex(args[1], &offset) ||
+        (set && !IS_NUMBER(args[2]))) {
+        runtimeError(set ? "%s() expects an offset, a number and an optional little-endian flag."
+                         : "%s() expects an offset and an optional little-endian flag.", method);
+        return false;
+    }
+    if (offset < 0 || offset > bytes->length - size) {
+        runtimeError("Offset %d out of bounds for length %d.", offset, bytes->length);
+        return false;
+    }
+    Value flag = argCount > required ? args[required + 1] : BOOL_VAL(false);
+    bool littleEndian = !IS_NIL(flag) && !(IS_BOOL(flag) && !AS_BOOL(flag));
+    uint8_t *data = bytes->data + offset;
+
+    if (set) {
+        double number = AS_NUMBER(args[2]);
+        uint64_t raw;
+        if (isFloat && size == 4) {
+            float value = (float) number;
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            raw = bits;
+        } else if (isFloat) {
+            memcpy(&raw, &number, sizeof(raw));
+        } else {
+            raw = numberToUint32(number);
+        }
+        for (int i = 0; i < size; i++) {
+            int shift = 8 * (littleEndian ? i : size - 1 - i);
+            data[i] = (uint8_t) (raw >> shift);
+        }
+        args[0] = args[2];
+        return true;
+    }
+
+    uint64_t raw = 0;
+    for (int i = 0; i < size; i++) {
+        int shift = 8 * (littleEndian ? i : size - 1 - i);
+        raw |= (uint64_t) data[i] << shift;
+    }
+    if (isFloat && size == 4) {
+        uint32_t bits = (uint32_t) raw;
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        args[0] = NUMBER_VAL(value);
+    } else if (isFloat) {
+        double value;
+        memcpy(&value, &raw, sizeof(value));
+        args[0] = NUMBER_VAL(value);
+    } else if (isSigned) {
+        // 符号扩展
+        int64_t value = (int64_t) (raw << (64 - 8 * size)) >> (64 - 8 * size);
+        args[0] = INT_VAL((int32_t) value);
+    } else {
+        args[0] = raw <= INT32_MAX ? INT_VAL((int32_t) raw) : NUMBER_VAL((double) raw);
+    }
+    return true;
+}
+
+#define BYTES_ACCESSORS(name, size, isSigned, isFloat) \
+    static bool bytesGet##name(int argCount, Value *args) { \
+        return bytesAccess(argCount, args, size, isSigned, isFloat, false, "get" #name); \
+    } \
+    static bool bytesSet##name(int argCount, Value *args) { \
+        return bytesAccess(argCount, args, size, isSigned, isFloat, true, "set" #name); \
+    }
+
+BYTES_ACCESSORS(Int8, 1, true, false)
+BYTES_ACCESSORS(Uint8, 1, false, false)
+BYTES_ACCESSORS(Int16, 2, true, false)
+BYTES_ACCESSORS(Uint16, 2, false, false)
+BYTES_ACCESSORS(Int32, 4, true, false)
+BYTES_ACCESSORS(Uint32, 4, false, false)
+BYTES_ACCESSORS(Float32, 4, false, true)
+BYTES_ACCESSORS(Float64, 8, false, true)
+
+// length()：字节数
+static bool bytesLength(int argCount, Value *args) {
+    if (!expectArguments(argCount, 0)) return false;
+    args[0] = INT_VAL(AS_BYTES(args[0])->length);
+    return true;
+}
+
+// slice([start[, end]])：不拷贝数据的切片，写入切片会修改原缓冲区
+static bool bytesSlice(int argCount, Value *args) {
+    ObjBytes *bytes = AS_BYTES(args[0]);
+    int start;
+    int end;
+    if (!bytesRange(bytes, argCount, args, 1, &start, &end, "slice")) return false;
+    args[0] = OBJ_VAL(sliceBytes(bytes, start, end - start));
+    return true;
+}
+
+// copyFrom(source[, offset])：将字节缓冲区或字符串的内容复制到 offset 处，返回缓冲区本身
+static bool bytesCopyFrom(int argCount, Value *args) {
+    ObjBytes *bytes = AS_BYTES(args[0]);
+    int offset = 0;
+    if (argCount < 1 || argCount > 2 || !(IS_BYTES(args[1]) || IS_ANY_STRING(args[1])) ||
+        (argCount == 2 && !asIndex(args[2], &offset))) {
+        runtimeError("copyFrom() expects bytes or a string and an optional offset.");
+        return false;
+    }
+    const uint8_t *source;
+    int length;
+    if (IS_BYTES(args[1])) {
+        source = AS_BYTES(args[1])->data;
+        length = AS_BYTES(args[1])->length;
+    } else {
+        ObjString *string = asFlatString(args[1]);
+        source = (const uint8_t *) string->chars;
+        length = string->length;
+    }
+    if (offset < 0 || offset > bytes->length - length) {
+        runtimeError("Cannot copy %d bytes to offset %d of length %d.", length, offset, bytes->length);
+        return false;
+    }
+    // 源与目标可能是同一块内存的两个切片
+    if (length > 0) memmove(bytes->data + offset, source, length);
+    return true;
+}
+
+// fill(value[, start[, end]])：将范围内的字节都设为 value，返回缓冲区本身
+static bool bytesFill(int argCount, Value *args) {
+    ObjBytes *bytes = AS_BYTES(args[0]);
+    if (argCount < 1 || !IS_NUMBER(args[1])) {
+        runtimeError("fill() expects a byte value and an optional start and end index.");
+        return false;
+    }
+    int start;
+    int end;
+    if (!bytesRange(bytes, argCount, args, 2, &start, &end, "fill")) return false;
+    if (end > start) memset(bytes->data + start, (uint8_t) numberToUint32(AS_NUMBER(args[1])), end - start);
+    return true;
+}
+
+// toString([start[, end]])：将范围内的字节复制为字符串（与其他运行时字符串一样不驻留）
+static bool bytesToString(int argCount, Value *args) {
+    ObjBytes *bytes = AS_BYTES(args[0]);
+    int start;
+    int end;
+    if (!bytesRange(bytes, argCount, args, 1, &start, &end, "toString")) return false;
+    ObjString *string = newString(end - start);
+    memcpy(string->chars, bytes->data + start, end - start);
+    args[0] = OBJ_VAL(string);
+    return true;
+}
+
+static NativeMethodEntry stringMethods[] = {
+        {"length",    stringLength,    NULL},
+        {"find",      stringFind,      NULL},
+        {"substring", stringSubstring, NULL},
+        {"replace",   stringReplace,   NULL},
+        {"split",     stringSplit,     NULL},
+        {NULL,        NULL,            NULL},
+};
+
+static NativeMethodEntry listMethods[] = {
+        {"append", listAppend, NULL},
+        {"pop",    listPop,    NULL},
+        {"length", listLength, NULL},
+        {"sort",   listSort,   NULL},
+        {NULL,     NULL,       NULL},
+};
+
+static NativeMethodEntry typedArrayMethods[] = {
+        {"length",    typedArrayLength,    NULL},
+        {"sum",       typedArraySum,       NULL},
+        {"min",       typedArrayMin,       NULL},
+        {"max",       typedArrayMax,       NULL},
+        {"dot",       typedArrayDot,       NULL},
+        {"scale",     typedArrayScale,     NULL},
+        {"axpy",      typedArrayAxpy,      NULL},
+        {"add",       typedArrayAdd,       NULL},
+        {"mul",       typedArrayMul,       NULL},
+        {"prefixSum", typedArrayPrefixSum, NULL},
+        {NULL,        NULL,                NULL},
+};
+
+static NativeMethodEntry bytesMethods[] = {
+        {"length",     bytesLength,     NULL},
+        {"slice",      bytesSlice,      NULL},
+        {"copyFrom",   bytesCopyFrom,   NULL},
+        {"fill",       bytesFill,       NULL},
+        {"toString",   bytesToString,   NULL},
+        {"getInt8",    bytesGetInt8,    NULL},
+        {"setInt8",    bytesSetInt8,    NULL},
+        {"getUint8",   bytesGetUint8,   NULL},
+        {"setUint8",   bytesSetUint8,   NULL},
+        {"getInt16",   bytesGetInt16,   NULL},
+        {"setInt16",   bytesSetInt16,   NULL},
+        {"getUint16",  bytesGetUint16,  NULL},
+        {"setUint16",  bytesSetUint16,  NULL},
+        {"getInt32",   bytesGetInt32,   NULL},
+        {"setInt32",   bytesSetInt32,   NULL},
+        {"getUint32",  bytesGetUint32,  NULL},
+        {"setUint32",  bytesSetUint32,  NULL},
+        {"getFloat32", bytesGetFloat32, NULL},
+        {"setFloat32", bytesSetFloat32, NULL},
+        {"getFloat64", bytesGetFloat64, NULL},
+        {"setFloat64", bytesSetFloat64, NULL},
+        {NULL,         NULL,            NULL},
+};
+
+static NativeMethodEntry mapMethods[] = {
+        {"length", mapLength, NULL},
+        {"has",    mapHas,    NULL},
+        {"remove", mapRemove, NULL},
+        {"keys",   mapKeys,   NULL},
+        {"values", mapValues, NULL},
+        {NULL,     NULL,      NULL},
+};
+
+static NativeMethodEntry stringBuilderMethods[] = {
+        {"append",       builderAppend,       NULL},
+        {"appendNumber", builderAppendNumber, NULL},
+        {"reserve",      builderReserve,      NULL},
+        {"toString",     builderToString,     NULL},
+        {"length",       builderLength,       NULL},
+        {NULL,           NULL,                NULL},
+};
+
+// 各对象类型的方法表，没有内置方法的类型为 NULL
+static NativeMethodEntry *methodTables[] = {
+        [OBJ_STRING] = stringMethods,
+        [OBJ_ROPE] = stringMethods,
+        [OBJ_STRING_BUILDER] = stringBuilderMethods,
+        [OBJ_LIST] = listMethods,
+        [OBJ_MAP] = mapMethods,
+        [OBJ_TYPED_ARRAY] = typedArrayMethods,
+        [OBJ_BYTES] = bytesMethods,
+};
+
+#define METHOD_TABLE_COUNT ((int) (sizeof(methodTables) / sizeof(methodTables[0])))
+
+void initNativeMethods() {
+    for (int type = 0; type < METHOD_TABLE_COUNT; type++) {
+        if (methodTables[type] == NULL) continue;
+        for (NativeMethodEntry *entry = methodTables[type]; entry->name != NULL; entry++) {
+            // 名称为静态数据，不需要拷贝
+            entry->nameString = externalString(entry->name, (int) strlen(entry->name), NULL);
+        }
+    }
+}
+
+void markNativeMethods() {
+    for (int type = 0; type < METHOD_TABLE_COUNT; type++) {
+        if (methodTables[type] == NULL) continue;
+        for (NativeMethodEntry *entry = methodTables[type]; entry->name != NULL; entry++) {
+            markObject((Obj *) entry->nameString);
+        }
+    }
+}
+
+NativeMethod findNativeMethod(Value receiver, ObjString *name) {
+    if (!IS_OBJ(receiver)) return NULL;
+    ObjType type = OBJ_TYPE(receiver);
+    if ((int) type >= METHOD_TABLE_COUNT || methodTables[type] == NULL) return NULL;
+    for (NativeMethodEntry *entry = methodTables[type]; entry->name != NULL; entry++) {
+        if (entry->nameString == name) return entry->method;
+    }
+    return NULL;
+}
+
+bool stringBuilderNative(int argCount, Value *args) {
+    args[0] = OBJ_VAL(newStringBuilder());
+    return true;
+}
+
+// 构造函数 Bytes(n | string)：n 个 0，或者字符串内容的副本
+bool bytesNative(int argCount, Value *args) {
+    if (argCount == 1 && IS_ANY_STRING(args[1])) {
+        ObjString *string = asFlatString(args[1]);
+        ObjBytes *bytes = newBytes(string->length);
+        if (string->length > 0) memcpy(bytes->data, string->chars, string->length);
+        args[0] = OBJ_VAL(bytes);
+        return true;
+    }
+    int length;
+    if (argCount != 1 || !asIndex(args[1], &length) || length < 0) {
+        runtimeError("Bytes() expects a length or a string.");
+        return false;
+    }
+    args[0] = OBJ_VAL(newBytes(length));
+    return true;
+}
+
+// mapFile(path)：不拷贝地映射整个文件（写时复制，修改不会写回文件）
+bool mapFileNative(int argCount, Value *args) {
+    if (argCount != 1 || !IS_ANY_STRING(args[1])) {
+        runtimeError("mapFile() expects a path.");
+        return false;
+    }
+    // 字符串不一定以 '\0' 结尾
+    ObjString *path = asFlatString(args[1]);
+    char *cPath = malloc(path->length + 1);
+    if (cPath == NULL) exit(1);
+    memcpy(cPath, path->chars, path->length);
+    cPath[path->length] = '\0';
+    int fd = open(cPath, O_RDONLY);
+    free(cPath);
+    struct stat info;
+    if (fd < 0 || fstat(fd, &info) != 0 || info.st_size > INT32_MAX) {
+        if (fd >= 0) close(fd);
+        runtimeError("Could not map file '%.*s'.", path->length, path->chars);
+        return false;
+    }
+    int length = (int) info.st_size;
+    if (length == 0) {
+        close(fd);
+        args[0] = OBJ_VAL(newBytes(0));
+        return true;
+    }
+    void *data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        runtimeError("Could not map file '%.*s'.", path->length, path->chars);
+        return false;
+    }
+    args[0] = OBJ_VAL(mappedBytes(data, length));
+    return true;
+}
+
+// jsonParse(text)：将 JSON 文本解析为映射、列表、字符串、数字、布尔值或 nil
+bool jsonParseNative(int argCount, Value *args) {
+    if (argCount != 1 || !IS_ANY_STRING(args[1])) {
+        runtimeError("jsonParse() expects a string.");
+        return false;
+    }
+    return jsonParse(asFlatString(args[1]), &args[0]);
+}
+
+// jsonStringify(value)：将值序列化为紧凑的 JSON 文本
+bool jsonStringifyNative(int argCount, Value *args) {
+    if (!expectArguments(argCount, 1)) return false;
+    return jsonStringify(args[1], &args[0]);
+}
+
+// 数值数组的构造函数：参数为长度（元素都为 0），或者用数字列表初始化
+static bool newTypedArrayNative(int argCount, Value *args, TypedArrayType type, const char *name) {
+    if (argCount == 1 && IS_LIST(args[1])) {
+        ValueArray *items = &AS_LIST(args[1])->items;
+        for (int i = 0; i < items->count; i++) {
+            if (!IS_NUMBER(items->values[i])) {
+                runtimeError("%s() expects a list of numbers.", name);
+                return false;
+            }
+        }
+        ObjTypedArray *array = newTypedArray(type, items->count);
+        for (int i = 0; i < items->count; i++) typedArraySet(array, i, AS_NUMBER(items->values[i]));
+        args[0] = OBJ_VAL(array);
+        return true;
+    }
+    // 写成 !(0 <= n <= INT32_MAX)，NaN 在转换为 int 之前就被拒绝
+    if (argCount != 1 || !IS_NUMBER(args[1]) || !(AS_NUMBER(args[1]) >= 0 && AS_NUMBER(args[1]) <= INT32_MAX) ||
+        AS_NUMBER(args[1]) != (int) AS_NUMBER(args[1])) {
+        runtimeError("%s() expects a length or a list of numbers.", name);
+        return false;
+    }
+    args[0] = OBJ_VAL(newTypedArray(type, (int) AS_NUMBER(args[1])));
+    return true;
+}
+
+bool float64ArrayNative(int argCount, Value *args) {
+    return newTypedArrayNative(argCount, args, TYPED_FLOAT64, "Float64Array");
+}
+
+bool int32ArrayNative(int argCount, Value *args) {
+    return newTypedArrayNative(argCount, args, TYPED_INT32, "Int32Array");
+}
+
+bool uint8ArrayNative(int argCount, Value *args) {
+    return newTypedArrayNative(argCount, args, TYPED_UINT8, "Uint8Array");
+}
@@ -0,0 +1,46 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#ifndef PANDA_NATIVE_H
+#define PANDA_NATIVE_H
+
+#include "common.h"
+#include "object.h"
+
+// 内置类型的方法：args[0] 为接收者，args[1..argCount] 为参数，结果写回 args[0]
+// 出错时调用 runtimeError 并返回 false
+typedef bool (*NativeMethod)(int argCount, Value *args);
+
+// 驻留各内置方法的名称
+void initNativeMethods();
+
+// 标记方法名称，防止被当作白色字符串从驻留表中移除
+void markNativeMethods();
+
+// 按名称查找接收者类型的内置方法，找不到返回 NULL
+NativeMethod findNativeMethod(Value receiver, ObjString *name);
+
+// 构造函数 StringBuilder()
+bool stringBuilderNative(int argCount, Value *args);
+
+// 构造函数 Bytes(n)，参数也可以是字符串（复制其内容）
+bool bytesNative(int argCount, Value *args);
+
+// mapFile(path)：将文件映射为字节缓冲区
+bool mapFileNative(int argCount, Value *args);
+
+// jsonParse(text)
+bool jsonParseNative(int argCount, Value *args);
+
+// jsonStringify(value)
+bool jsonStringifyNative(int argCount, Value *args);
+
+// 构造函数 Float64Array(n)、Int32Array(n)、Uint8Array(n)，参数也可以是数字列表
+bool float64ArrayNative(int argCount, Value *args);
+
+bool int32ArrayNative(int argCount, Value *args);
+
+bool uint8ArrayNative(int argCount, Value *args);
+
+#endif //PANDA_NATIVE_H
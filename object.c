@@ -3,9 +3,11 @@
 //
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "memory.h"
+#include "hash.h"
 #include "object.h"
 #include "value.h"
 #include "vm.h"
@@ -16,12 +18,9 @@
 // 输入对象大小、对象类型。分配一个对象，并传回对象指针（？？？）
 static Obj *allocateObject(size_t size, ObjType type) {
     //
-    Obj *object = (Obj *) reallocate(NULL, 0, size);
-    object->type = type;
-    // 标记为 true 才可进行垃圾回收
-    object->isMarked = false;
-    // 头插法，将新建的对象插入到虚拟机的对象链中
-    object->next = vm.objects;
+    Obj *object = (Obj *) reallocateObject(NULL, 0, size);
+    // 未标记，头插法，将新建的对象插入到虚拟机的对象链中
+    object->header = OBJ_HEADER(type, vm.objects);
     vm.objects = object;
 #ifdef DEBUG_LOG_GC
     printf("%p allocate %zu for %d\n", (void *) object, size, type);
@@ -36,7 +35,7 @@ ObjBoundMethod *newBoundMethod(Value receiver, ObjClosure *method) {
     //
     bound->receiver = receiver;
     //
-    bound->method = method;
+    bound->method = TO_REF(method);
     return bound;
 }
 
@@ -45,20 +44,73 @@ ObjClass *newClass(ObjString *name) {
     ObjClass *klass = ALLOCATE_OBJ(ObjClass, OBJ_CLASS);
     klass->name = name;
     initTable(&klass->methods);
+    klass->superclass = NULL;
     return klass;
 }
 
-// 分配一个字符串内存
-static ObjString *allocateString(char *chars, int length,
-                                 uint32_t hash) {
-    ObjString *string = ALLOCATE_OBJ(ObjString, OBJ_STRING);
+// 新建一个字符串，对象头和字符（包括末尾的 '\0'）只分配一次
+ObjString *newString(int length) {
+    ObjString *string = (ObjString *) allocateObject(sizeof(ObjString) + length + 1, OBJ_STRING);
     string->length = length;
+    string->hash = 0;
+    string->chars = (char *) (string + 1);
+    string->chars[length] = '\0';
+    return string;
+}
+
+// 缓冲区对应的字符串对象头
+#define STRING_BUFFER_HEADER(chars) ((ObjString *) ((chars) - sizeof(ObjString)))
+
+// 分配字符串缓冲区，缓冲区前预留字符串对象头，后面预留 '\0'
+char *allocateStringBuffer(int capacity) {
+    char *block = reallocateObject(NULL, 0, sizeof(ObjString) + capacity + 1);
+    return block + sizeof(ObjString);
+}
+
+// 调整字符串缓冲区的容量
+char *reallocateStringBuffer(char *chars, int oldCapacity, int capacity) {
+    void *block = chars == NULL ? NULL : STRING_BUFFER_HEADER(chars);
+    size_t oldSize = chars == NULL ? 0 : sizeof(ObjString) + oldCapacity + 1;
+    size_t newSize = capacity == 0 ? 0 : sizeof(ObjString) + capacity + 1;
+    block = reallocateObject(block, oldSize, newSize);
+    return block == NULL ? NULL : (char *) block + sizeof(ObjString);
+}
+
+// 接管字符串缓冲区，收缩到实际长度后补上对象头，挂到对象链上
+ObjString *takeString(char *chars, int length, int capacity) {
+    if (chars == NULL) {
+        chars = allocateStringBuffer(length);
+    } else if (capacity != length) {
+        chars = reallocateStringBuffer(chars, capacity, length);
+    }
+    ObjString *string = STRING_BUFFER_HEADER(chars);
+    string->obj.header = OBJ_HEADER(OBJ_STRING, vm.objects);
+    vm.objects = (Obj *) string;
+#ifdef DEBUG_LOG_GC
+    printf("%p allocate %zu for %d\n", (void *) string, sizeof(ObjString) + length + 1, OBJ_STRING);
+#endif
+    string->length = length;
+    string->hash = 0;
     string->chars = chars;
-    string->hash = hash;
+    string->chars[length] = '\0';
+    return string;
+}
+
+// 新建字符串构建器
+ObjStringBuilder *newStringBuilder() {
+    ObjStringBuilder *builder = ALLOCATE_OBJ(ObjStringBuilder, OBJ_STRING_BUILDER);
+    builder->length = 0;
+    builder->capacity = 0;
+    builder->chars = NULL;
+    return builder;
+}
+
+// 将已计算哈希的字符串加入驻留表
+static ObjString *addInternedString(ObjString *string) {
+    OBJ_SET_FLAG(&string->obj, STRING_INTERNED);
     // 将其 push 入虚拟机栈中（垃圾回收时可能会用到，？？？）
     push(OBJ_VAL(string));
-    // 键为字符串，值为 NIL（不关心值是多少）
-    tableSet(&vm.strings, string, NIL_VAL);
+    stringSetAdd(&vm.strings, string);
 
     pop();
     return string;
@@ -67,10 +119,10 @@ static ObjString *allocateString(char *chars, int length,
 // 新建闭包
 ObjClosure *newClosure(ObjFunction *function) {
     // 开辟一个上值数组，传入上值数量
-    ObjUpvalue **upvalues = ALLOCATE(ObjUpvalue*, function->upvalueCount);
+    REF(ObjUpvalue) *upvalues = ALLOCATE(REF(ObjUpvalue), function->upvalueCount);
     // 上值数组先为空
     for (int i = 0; i < function->upvalueCount; i++) {
-        upvalues[i] = NULL;
+        upvalues[i] = NULL_REF;
     }
     ObjClosure *closure = ALLOCATE_OBJ(ObjClosure, OBJ_CLOSURE);
     closure->function = function;
@@ -99,12 +151,112 @@ ObjInstance *newInstance(ObjClass *klass) {
     // 开辟一个对象内存
     ObjInstance *instance = ALLOCATE_OBJ(ObjInstance, OBJ_INSTANCE);
     // 指向该对象的类
-    instance->klass = klass;
+    instance->klass = TO_REF(klass);
     // 初始化属性表
     initTable(&instance->fields);
     return instance;
 }
 
+// 先分配元素数组再分配列表对象：分配数组时触发的 GC 不会回收还没有被引用的列表
+ObjList *newList(int capacity) {
+    Value *values = capacity > 0 ? ALLOCATE(Value, capacity) : NULL;
+    ObjList *list = ALLOCATE_OBJ(ObjList, OBJ_LIST);
+    list->items.count = 0;
+    list->items.capacity = capacity;
+    list->items.values = values;
+    return list;
+}
+
+ObjMap *newMap() {
+    ObjMap *map = ALLOCATE_OBJ(ObjMap, OBJ_MAP);
+    map->count = 0;
+    map->entryCount = 0;
+    map->entryCapacity = 0;
+    map->entries = NULL;
+    map->indexCapacity = 0;
+    map->index = NULL;
+    return map;
+}
+
+// 与 newList 相同，先分配数据再分配对象
+ObjBytes *newBytes(int length) {
+    uint8_t *data = length > 0 ? ALLOCATE(uint8_t, length) : NULL;
+    if (length > 0) memset(data, 0, length);
+    ObjBytes *bytes = ALLOCATE_OBJ(ObjBytes, OBJ_BYTES);
+    bytes->storage = BYTES_OWNED;
+    bytes->length = length;
+    bytes->data = data;
+    bytes->owner = NULL;
+    return bytes;
+}
+
+ObjBytes *mappedBytes(uint8_t *data, int length) {
+    ObjBytes *bytes = ALLOCATE_OBJ(ObjBytes, OBJ_BYTES);
+    bytes->storage = BYTES_MAPPED;
+    bytes->length = length;
+    bytes->data = data;
+    bytes->owner = NULL;
+    return bytes;
+}
+
+// 切片的 owner 总是持有内存的缓冲区，切片的切片不会形成引用链
+ObjBytes *sliceBytes(ObjBytes *parent, int start, int length) {
+    Obj *owner = parent->storage == BYTES_VIEW ? parent->owner : (Obj *) parent;
+    ObjBytes *bytes = ALLOCATE_OBJ(ObjBytes, OBJ_BYTES);
+    bytes->storage = BYTES_VIEW;
+    bytes->length = length;
+    bytes->data = parent->data + start;
+    bytes->owner = owner;
+    return bytes;
+}
+
+size_t typedArrayElementSize(TypedArrayType type) {
+    switch (type) {
+        case TYPED_FLOAT64:
+            return sizeof(double);
+        case TYPED_INT32:
+            return sizeof(int32_t);
+        case TYPED_UINT8:
+            return sizeof(uint8_t);
+    }
+    return 0; // Unreachable.
+}
+
+ObjTypedArray *newTypedArray(TypedArrayType type, int length) {
+    size_t size = typedArrayElementSize(type) * length;
+    ObjTypedArray *array = (ObjTypedArray *) allocateObject(sizeof(ObjTypedArray) + size, OBJ_TYPED_ARRAY);
+    array->type = type;
+    array->length = length;
+    memset(TYPED_ARRAY_DATA(array), 0, size);
+    return array;
+}
+
+Value typedArrayGet(ObjTypedArray *array, int index) {
+    switch (array->type) {
+        case TYPED_FLOAT64:
+            return NUMBER_VAL(TYPED_ARRAY_FLOAT64(array)[index]);
+        case TYPED_INT32:
+            return INT_VAL(TYPED_ARRAY_INT32(array)[index]);
+        case TYPED_UINT8:
+            return INT_VAL(TYPED_ARRAY_UINT8(array)[index]);
+    }
+    return NIL_VAL; // Unreachable.
+}
+
+void typedArraySet(ObjTypedArray *array, int index, double value) {
+    switch (array->type) {
+        case TYPED_FLOAT64:
+            TYPED_ARRAY_FLOAT64(array)[index] = value;
+            break;
+        case TYPED_INT32:
+            TYPED_ARRAY_INT32(array)[index] = (int32_t) numberToUint32(value);
+            break;
+        case TYPED_UINT8:
+            TYPED_ARRAY_UINT8(array)[index] = (uint8_t) numberToUint32(value);
+            break;
+    }
+}
+
 // 新建一个本地函数？？？？
 ObjNative *newNative(NativeFn function) {
     ObjNative *native = ALLOCATE_OBJ(ObjNative, OBJ_NATIVE);
@@ -112,26 +264,52 @@ ObjNative *newNative(NativeFn function) {
     return native;
 }
 
-// 输入字符数组和长度、计算 hash 值
-static uint32_t hashString(const char *key, int length) {
-    uint32_t hash = 2166136261u;
-    for (int i = 0; i < length; i++) {
-        hash ^= (uint8_t) key[i];
-        hash *= 16777619;
-    }
-    return hash;
-}
-
 // 拷贝字符串、如果传入的字符串存在，则不重新分配内存，而是用原来的副本
 ObjString *copyString(const char *chars, int length) {
     uint32_t hash = hashString(chars, length);
-    ObjString *interned = tableFindString(&vm.strings, chars, length,
+    ObjString *interned = stringSetFind(&vm.strings, chars, length,
                                           hash);
     if (interned != NULL) return interned;
-    char *heapChars = ALLOCATE(char, length + 1);
-    memcpy(heapChars, chars, length);
-    heapChars[length] = '\0';
-    return allocateString(heapChars, length, hash);
+    ObjString *string = newString(length);
+    memcpy(string->chars, chars, length);
+    string->hash = hash;
+    OBJ_SET_FLAG(&string->obj, STRING_HASHED);
+    return addInternedString(string);
+}
+
+// 创建引用外部字符的字符串，与 copyString 一样会先查找驻留表
+ObjString *externalString(const char *chars, int length, Obj *owner) {
+    uint32_t hash = hashString(chars, length);
+    ObjString *interned = stringSetFind(&vm.strings, chars, length, hash);
+    if (interned != NULL) return interned;
+    ObjExternalString *external = ALLOCATE_OBJ(ObjExternalString, OBJ_STRING);
+    external->owner = owner;
+    ObjString *string = &external->string;
+    string->length = length;
+    string->hash = hash;
+    string->chars = (char *) chars;
+    OBJ_SET_FLAG(&string->obj, STRING_HASHED | STRING_EXTERNAL);
+    return addInternedString(string);
+}
+
+// 创建 parent 的子串。较长的子串为引用父字符串字符的视图，较短的直接拷贝
+ObjString *substring(ObjString *parent, int start, int length) {
+    if (length < STRING_VIEW_MIN_LENGTH) {
+        ObjString *string = newString(length);
+        memcpy(string->chars, parent->chars + start, length);
+        return string;
+    }
+    // 视图总是引用最终持有字符的对象，而不是中间的视图
+    Obj *owner = (Obj *) parent;
+    if (STRING_IS_EXTERNAL(parent)) owner = ((ObjExternalString *) parent)->owner;
+    ObjExternalString *view = ALLOCATE_OBJ(ObjExternalString, OBJ_STRING);
+    view->owner = owner;
+    ObjString *string = &view->string;
+    string->length = length;
+    string->hash = 0;
+    string->chars = parent->chars + start;
+    OBJ_SET_FLAG(&string->obj, STRING_EXTERNAL);
+    return string;
 }
 
 // 输入函数对象指针，输出函数名称
@@ -142,7 +320,7 @@ static void printFunction(ObjFunction *function) {
         return;
     }
     // 输出函数名
-    printf("<fn %s>", function->name->chars);
+    printf("<fn %.*s>", function->name->length, function->name->chars);
 }
 
 // 将值转为一个上值对象
@@ -156,14 +334,103 @@ ObjUpvalue *newUpvalue(Value *slot) {
     upvalue->next = NULL;
     return upvalue;
 }
+// 新建拼接节点
+ObjRope *newRope(Obj *left, Obj *right, int length) {
+    ObjRope *rope = ALLOCATE_OBJ(ObjRope, OBJ_ROPE);
+    rope->length = length;
+    rope->left = left;
+    rope->right = right;
+    rope->flat = NULL;
+    return rope;
+}
+
+// 按从左到右的顺序遍历拼接节点中的每一段字符（不分配 GC 内存）
+static void visitRope(ObjRope *rope, void (*visit)(const char *chars, int length, void *context), void *context) {
+    // 显式栈，避免循环拼接得到的深层节点导致递归过深
+    int count = 0;
+    int capacity = 8;
+    Obj **stack = (Obj **) malloc(sizeof(Obj *) * capacity);
+    if (stack == NULL) exit(1);
+    stack[count++] = (Obj *) rope;
+    while (count > 0) {
+        Obj *node = stack[--count];
+        if (OBJ_HEADER_TYPE(node) == OBJ_STRING) {
+            ObjString *string = (ObjString *) node;
+            visit(string->chars, string->length, context);
+            continue;
+        }
+        ObjRope *part = (ObjRope *) node;
+        if (part->flat != NULL) {
+            visit(part->flat->chars, part->flat->length, context);
+            continue;
+        }
+        if (capacity < count + 2) {
+            capacity = GROW_CAPACITY(capacity);
+            stack = (Obj **) realloc(stack, sizeof(Obj *) * capacity);
+            if (stack == NULL) exit(1);
+        }
+        // 先压右边，再压左边，保证左边先出栈
+        stack[count++] = part->right;
+        stack[count++] = part->left;
+    }
+    free(stack);
+}
+
+// 将一段字符追加到展开的缓冲区中
+static void appendRopeChars(const char *chars, int length, void *context) {
+    char **cursor = (char **) context;
+    memcpy(*cursor, chars, length);
+    *cursor += length;
+}
+
+// 展开拼接节点，调用方需要保证 rope 可以被 GC 找到
+ObjString *flattenRope(ObjRope *rope) {
+    if (rope->flat != NULL) return rope->flat;
+    ObjString *string = newString(rope->length);
+    char *cursor = string->chars;
+    visitRope(rope, appendRopeChars, &cursor);
+    // 与其他运行时字符串一样，不立即驻留
+    rope->flat = string;
+    // 已经有了展开后的字符串，不再需要左右两部分
+    rope->left = NULL;
+    rope->right = NULL;
+    return rope->flat;
+}
+
+// 比较两个字符串的内容
+bool stringsEqual(Obj *a, Obj *b) {
+    if (a == b) return true;
+    ObjString *left = OBJ_HEADER_TYPE(a) == OBJ_ROPE ? NULL : (ObjString *) a;
+    ObjString *right = OBJ_HEADER_TYPE(b) == OBJ_ROPE ? NULL : (ObjString *) b;
+    // 两个驻留的字符串只有指针相同时才相等
+    if (left != NULL && right != NULL && STRING_IS_INTERNED(left) && STRING_IS_INTERNED(right)) return false;
+    int leftLength = left != NULL ? left->length : ((ObjRope *) a)->length;
+    int rightLength = right != NULL ? right->length : ((ObjRope *) b)->length;
+    if (leftLength != rightLength) return false;
+    if (left == NULL) left = flattenRope((ObjRope *) a);
+    if (right == NULL) right = flattenRope((ObjRope *) b);
+    if (left == right) return true;
+    // 都已经计算过哈希时，哈希不同则一定不相等
+    if (OBJ_HAS_FLAG(&left->obj, STRING_HASHED) && OBJ_HAS_FLAG(&right->obj, STRING_HASHED) &&
+        left->hash != right->hash) {
+        return false;
+    }
+    return memcmp(left->chars, right->chars, leftLength) == 0;
+}
+
+// 直接输出一段字符
+static void printRopeChars(const char *chars, int length, void *context) {
+    fwrite(chars, sizeof(char), length, stdout);
+}
+
 // 输出对象名称
 void printObject(Value value) {
     switch (OBJ_TYPE(value)) {
         case OBJ_CLASS:
-            printf("%s", AS_CLASS(value)->name->chars);
+            printf("%.*s", AS_CLASS(value)->name->length, AS_CLASS(value)->name->chars);
             break;
         case OBJ_BOUND_METHOD:
-            printFunction(AS_BOUND_METHOD(value)->method->function);
+            printFunction(BOUND_METHOD(AS_BOUND_METHOD(value))->function);
             break;
             // 输出闭包对象
         case OBJ_CLOSURE:
@@ -173,28 +440,85 @@ void printObject(Value value) {
             printFunction(AS_FUNCTION(value));
             break;
         case OBJ_STRING:
-            printf("%s", AS_CSTRING(value));
+            fwrite(AS_CSTRING(value), sizeof(char), AS_STRING(value)->length, stdout);
+            break;
+        case OBJ_ROPE:
+            // 输出时逐段输出，不需要分配内存（GC 日志中也会输出对象）
+            visitRope(AS_ROPE(value), printRopeChars, NULL);
+            break;
+        case OBJ_STRING_BUILDER:
+            printf("<string builder>");
             break;
         case OBJ_UPVALUE:
             printf("upvalue");
             break;
         case OBJ_INSTANCE:
-            printf("%s instance", AS_INSTANCE(value)->klass->name->chars);
+            printf("%.*s instance", INSTANCE_CLASS(AS_INSTANCE(value))->name->length,
+                   INSTANCE_CLASS(AS_INSTANCE(value))->name->chars);
             break;
         case OBJ_NATIVE:
             printf("<native fn>");
             break;
+        case OBJ_MAP: {
+            ObjMap *map = AS_MAP(value);
+            printf("{");
+            bool first = true;
+            for (int i = 0; i < map->entryCount; i++) {
+                if (IS_NIL(map->entries[i].key)) continue;
+                if (!first) printf(", ");
+                first = false;
+                printValue(map->entries[i].key);
+                printf(": ");
+                printValue(map->entries[i].value);
+            }
+            printf("}");
+            break;
+        }
+        case OBJ_BYTES:
+            printf("<bytes %d>", AS_BYTES(value)->length);
+            break;
+        case OBJ_TYPED_ARRAY: {
+            static const char *names[] = {"Float64Array", "Int32Array", "Uint8Array"};
+            ObjTypedArray *array = AS_TYPED_ARRAY(value);
+            printf("%s[", names[array->type]);
+            for (int i = 0; i < array->length; i++) {
+                if (i > 0) printf(", ");
+                printValue(typedArrayGet(array, i));
+            }
+            printf("]");
+            break;
+        }
+        case OBJ_LIST: {
+            ObjList *list = AS_LIST(value);
+            printf("[");
+            for (int i = 0; i < list->items.count; i++) {
+                if (i > 0) printf(", ");
+                printValue(list->items.values[i]);
+            }
+            printf("]");
+            break;
+        }
     }
 }
 
-// 将传入的C 语言字符串转为字符串对象，与其他的对象直接宏转不同、这个需要插入到 hash 表中
-ObjString *takeString(char *chars, int length) {
-    uint32_t hash = hashString(chars, length);
-    // 如果找到了，在返回它之前，我们释放传入的字符串的内存。因为所有权被传递给了这个函数，我们不再需要这个重复的字符串，所以由我们释放它。
-    ObjString *interned = tableFindString(&vm.strings, chars, length, hash);
-    if (interned != NULL) {
-        FREE_ARRAY(char, chars, length + 1);
-        return interned;
+// 返回字符串的哈希值，第一次使用时才计算
+uint32_t stringHash(ObjString *string) {
+    if (!OBJ_HAS_FLAG(&string->obj, STRING_HASHED)) {
+        string->hash = hashString(string->chars, string->length);
+        OBJ_SET_FLAG(&string->obj, STRING_HASHED);
+    }
+    return string->hash;
+}
+
+// 返回与 string 内容相同的驻留字符串
+ObjString *internString(ObjString *string) {
+    if (STRING_IS_INTERNED(string)) return string;
+    uint32_t hash = stringHash(string);
+    ObjString *interned = stringSetFind(&vm.strings, string->chars, string->length, hash);
+    if (interned != NULL) return interned;
+    // 子串视图会让父字符串一直存活，驻留前先拷贝出来
+    if (STRING_IS_EXTERNAL(string) && ((ObjExternalString *) string)->owner != NULL) {
+        return copyString(string->chars, string->length);
     }
-    return allocateString(chars, length, hash);
+    return addInternedString(string);
 }
@@ -10,10 +10,49 @@
 #include "table.h"
 #include "value.h"
 
+// 对象头：低 48 位为下一个对象（指针或压缩引用），48~55 位为对象类型，第 56 位为标记位
+// 用户态地址不超过 48 位（NaN boxing 同样依赖这一点）
+#define OBJ_NEXT_MASK   ((uint64_t)0x0000ffffffffffff)
+#define OBJ_TYPE_SHIFT  48
+#define OBJ_MARK_BIT    ((uint64_t)1 << 56)
+// 57 位以上为各类对象自用的标记位
+#define OBJ_FLAG(n)     ((uint64_t)1 << (57 + (n)))
+
+#define OBJ_HEADER(type, next)        (((uint64_t)(type) << OBJ_TYPE_SHIFT) | (uint64_t)(uintptr_t)TO_REF(next))
+#define OBJ_HEADER_TYPE(object)       ((ObjType)(((object)->header >> OBJ_TYPE_SHIFT) & 0xff))
+#define OBJ_IS_MARKED(object)         (((object)->header & OBJ_MARK_BIT) != 0)
+#define OBJ_SET_MARKED(object)        ((object)->header |= OBJ_MARK_BIT)
+#define OBJ_CLEAR_MARKED(object)      ((object)->header &= ~OBJ_MARK_BIT)
+#define OBJ_HAS_FLAG(object, flag)    (((object)->header & (flag)) != 0)
+#define OBJ_SET_FLAG(object, flag)    ((object)->header |= (flag))
+#define OBJ_SET_NEXT(object, next)    ((object)->header = ((object)->header & ~OBJ_NEXT_MASK) | \
+                                                          (uint64_t)(uintptr_t)TO_REF(next))
+#ifdef POINTER_COMPRESSION
+#define OBJ_NEXT(object)              FROM_REF(Obj, (uint32_t)((object)->header & OBJ_NEXT_MASK))
+#else
+#define OBJ_NEXT(object)              ((Obj*)(uintptr_t)((object)->header & OBJ_NEXT_MASK))
+#endif
+
+// 字符串的标记位：哈希值已计算、已驻留（驻留的字符串一定已计算哈希）
+#define STRING_HASHED                 OBJ_FLAG(0)
+#define STRING_INTERNED               OBJ_FLAG(1)
+// 外部字符串（ObjExternalString）：字符不属于字符串本身
+#define STRING_EXTERNAL               OBJ_FLAG(2)
+#define STRING_IS_INTERNED(string)    OBJ_HAS_FLAG(&(string)->obj, STRING_INTERNED)
+#define STRING_IS_EXTERNAL(string)    OBJ_HAS_FLAG(&(string)->obj, STRING_EXTERNAL)
+
+// 读取压缩引用字段
+#define CLOSURE_UPVALUE(closure, i)   FROM_REF(ObjUpvalue, (closure)->upvalues[i])
+#define INSTANCE_CLASS(instance)      FROM_REF(ObjClass, (instance)->klass)
+#define BOUND_METHOD(bound)           FROM_REF(ObjClosure, (bound)->method)
 // 返回对象类型
-#define OBJ_TYPE(value)        (AS_OBJ(value)->type)
+#define OBJ_TYPE(value)        OBJ_HEADER_TYPE(AS_OBJ(value))
 // 返回是否为字符串
 #define IS_STRING(value)       isObjType(value, OBJ_STRING)
+// 返回是否为拼接节点
+#define IS_ROPE(value)         isObjType(value, OBJ_ROPE)
+// 返回是否为字符串或拼接节点（脚本中都是字符串）
+#define IS_ANY_STRING(value)   (IS_STRING(value) || IS_ROPE(value))
 // 返回该值是否为函数
 #define IS_FUNCTION(value)     isObjType(value, OBJ_FUNCTION)
 #define IS_NATIVE(value)       isObjType(value, OBJ_NATIVE)
@@ -25,8 +64,24 @@
 #define IS_INSTANCE(value)     isObjType(value, OBJ_INSTANCE)
 
 #define IS_BOUND_METHOD(value) isObjType(value, OBJ_BOUND_METHOD)
+
+#define IS_STRING_BUILDER(value) isObjType(value, OBJ_STRING_BUILDER)
+
+#define IS_LIST(value)         isObjType(value, OBJ_LIST)
+
+#define IS_MAP(value)          isObjType(value, OBJ_MAP)
+
+#define IS_TYPED_ARRAY(value)  isObjType(value, OBJ_TYPED_ARRAY)
+
+#define IS_BYTES(value)        isObjType(value, OBJ_BYTES)
 // 返回ObjString*
 #define AS_STRING(value)       ((ObjString*)AS_OBJ(value))
+#define AS_ROPE(value)         ((ObjRope*)AS_OBJ(value))
+#define AS_STRING_BUILDER(value) ((ObjStringBuilder*)AS_OBJ(value))
+#define AS_LIST(value)         ((ObjList*)AS_OBJ(value))
+#define AS_MAP(value)          ((ObjMap*)AS_OBJ(value))
+#define AS_TYPED_ARRAY(value)  ((ObjTypedArray*)AS_OBJ(value))
+#define AS_BYTES(value)        ((ObjBytes*)AS_OBJ(value))
 // 返回字符数组本身
 #define AS_CSTRING(value)      (((ObjString*)AS_OBJ(value))->chars)
 // 返回函数对象
@@ -44,6 +99,8 @@
 typedef enum {
     // 对象方法
     OBJ_BOUND_METHOD,
+    // 可变的字节缓冲区
+    OBJ_BYTES,
     //
     OBJ_CLASS,
     // 闭包
@@ -52,20 +109,27 @@ typedef enum {
     OBJ_FUNCTION,
     // 实例
     OBJ_INSTANCE,
+    // 列表
+    OBJ_LIST,
+    // 映射
+    OBJ_MAP,
     // 本地调用
     OBJ_NATIVE,
+    // 字符串拼接节点
+    OBJ_ROPE,
     // 字符串
     OBJ_STRING,
+    // 可变的字符串构建器
+    OBJ_STRING_BUILDER,
+    // 元素类型固定的数值数组
+    OBJ_TYPED_ARRAY,
     // 闭包外值
     OBJ_UPVALUE
 } ObjType;
 
-//对象
+//对象，对象头压缩在一个 64 位字中：类型、垃圾回收标记、对象链中的下一个对象
 struct Obj {
-    ObjType type;
-    // 垃圾回收
-    bool isMarked;
-    struct Obj *next;
+    uint64_t header;
 };
 
 // 函数结构体
@@ -81,8 +145,9 @@ typedef struct {
     ObjString *name;
 } ObjFunction;
 
-// 定义了一个函数指针，返回值为 Value
-typedef Value (*NativeFn)(int argCount, Value *args);
+// 本地函数：args[0] 为函数本身所在的栈槽，args[1..argCount] 为参数，结果写回 args[0]
+// 出错时调用 runtimeError 并返回 false（与内置类型的方法相同）
+typedef bool (*NativeFn)(int argCount, Value *args);
 
 // 本地方法
 typedef struct {
@@ -90,15 +155,110 @@ typedef struct {
     NativeFn function;
 } ObjNative;
 
-// 字符串
+// 字符串。普通字符串的字符紧跟在对象后面，与对象头在同一块内存中，以 '\0' 结尾
+// 运行时创建的字符串不会立即计算哈希和驻留，用作表的键时才驻留
 struct ObjString {
     Obj obj;
     int length;
-    char *chars;
-    // 字符串的哈希值，用于在 hash 表中查找
+    // 字符串的哈希值，用于在 hash 表中查找（带有 STRING_HASHED 标记时有效）
     uint32_t hash;
+    // 指向字符。外部字符串指向不属于自己的内存，不一定以 '\0' 结尾，输出时需要使用 length
+    char *chars;
 };
 
+// 外部字符串：不拷贝字符，直接引用 owner 持有的内存（如 GC 管理的源码），owner 为 NULL 表示字符是静态数据
+typedef struct {
+    ObjString string;
+    Obj *owner;
+} ObjExternalString;
+
+// 字符串构建器：缓冲区按 GROW_CAPACITY 扩容，转为字符串时直接交出缓冲区
+typedef struct {
+    Obj obj;
+    int length;
+    int capacity;
+    // 由 allocateStringBuffer 分配，可以不拷贝地转为字符串
+    char *chars;
+} ObjStringBuilder;
+
+// 字符串拼接节点（rope）：+ 只记录左右两部分，字符在真正需要时才展开
+typedef struct {
+    Obj obj;
+    int length;
+    // 左右两部分，为 ObjString 或 ObjRope，展开后置空
+    Obj *left;
+    Obj *right;
+    // 展开后的字符串
+    ObjString *flat;
+} ObjRope;
+
+// 列表：元素连续存放，按 ValueArray 的方式扩容
+typedef struct {
+    Obj obj;
+    ValueArray items;
+} ObjList;
+
+// 映射的键值对，key 为 nil 表示已删除
+typedef struct {
+    Value key;
+    Value value;
+    uint32_t hash;
+} MapEntry;
+
+// 映射：键可以是任意非 nil 的值。键值对按插入顺序存放在 entries 中，
+// 另有一个与 Table 相同的分组探测索引（控制字节后面是 entries 的下标），键值对很少时不建索引，直接逐个比较
+typedef struct {
+    Obj obj;
+    // 键值对数量
+    int count;
+    // entries 中已使用的数量（包括已删除的）
+    int entryCount;
+    int entryCapacity;
+    MapEntry *entries;
+    // 索引槽位数，为 0 或 TABLE_GROUP_SIZE 以上的 2 的幂
+    int indexCapacity;
+    uint8_t *index;
+} ObjMap;
+
+// 数值数组的元素类型
+typedef enum {
+    TYPED_FLOAT64,
+    TYPED_INT32,
+    TYPED_UINT8,
+} TypedArrayType;
+
+// 数值数组：元素不装箱，紧跟在对象后面，与对象头在同一块内存中
+typedef struct {
+    Obj obj;
+    TypedArrayType type;
+    int length;
+} ObjTypedArray;
+
+#define TYPED_ARRAY_DATA(array)       ((void *) ((array) + 1))
+#define TYPED_ARRAY_FLOAT64(array)    ((double *) TYPED_ARRAY_DATA(array))
+#define TYPED_ARRAY_INT32(array)      ((int32_t *) TYPED_ARRAY_DATA(array))
+#define TYPED_ARRAY_UINT8(array)      ((uint8_t *) TYPED_ARRAY_DATA(array))
+
+// 字节缓冲区的内存来源
+typedef enum {
+    // 由缓冲区自己分配
+    BYTES_OWNED,
+    // 引用 owner 的一段内存（切片）
+    BYTES_VIEW,
+    // mmap 映射的文件
+    BYTES_MAPPED,
+} BytesStorage;
+
+// 可变的字节缓冲区，切片不拷贝数据，与原缓冲区共享内存
+typedef struct {
+    Obj obj;
+    BytesStorage storage;
+    int length;
+    uint8_t *data;
+    // 切片引用的缓冲区（总是持有内存的那一个），其余为 NULL
+    Obj *owner;
+} ObjBytes;
+
 // 闭包上值
 typedef struct ObjUpvalue {
     Obj obj;
@@ -111,21 +271,23 @@ typedef struct ObjUpvalue {
 typedef struct {
     Obj obj;
     ObjFunction *function;
-    ObjUpvalue **upvalues;
+    REF(ObjUpvalue) *upvalues;
     int upvalueCount;
 } ObjClosure;
 
 // 类
-typedef struct {
+// 继承时不拷贝父类的方法：methods 中只有自己定义的方法，以及查找过的父类方法的缓存
+typedef struct ObjClass {
     Obj obj;
     ObjString *name;
     Table methods;
+    struct ObjClass *superclass;
 } ObjClass;
 
 // 实例
 typedef struct {
     Obj obj;
-    ObjClass *klass;
+    REF(ObjClass) klass;
     Table fields;
 } ObjInstance;
 
@@ -133,7 +295,7 @@ typedef struct {
 typedef struct {
     Obj obj;
     Value receiver;
-    ObjClosure *method;
+    REF(ObjClosure) method;
 } ObjBoundMethod;
 
 ObjBoundMethod *newBoundMethod(Value receiver, ObjClosure *method);
@@ -146,22 +308,83 @@ ObjFunction *newFunction();
 
 ObjInstance *newInstance(ObjClass *klass);
 
+// 新建列表，预留 capacity 个元素的空间（元素数量为 0）
+ObjList *newList(int capacity);
+
+ObjMap *newMap();
+
+// 新建长度为 length、内容都为 0 的字节缓冲区
+ObjBytes *newBytes(int length);
+
+// 接管 mmap 映射的 length 个字节，释放时解除映射
+ObjBytes *mappedBytes(uint8_t *data, int length);
+
+// 创建 parent 从 start 开始、长度为 length 的切片
+ObjBytes *sliceBytes(ObjBytes *parent, int start, int length);
+
+// 每个元素的字节数
+size_t typedArrayElementSize(TypedArrayType type);
+
+// 新建长度为 length、元素都为 0 的数值数组
+ObjTypedArray *newTypedArray(TypedArrayType type, int length);
+
+// 读取第 index 个元素
+Value typedArrayGet(ObjTypedArray *array, int index);
+
+// 写入第 index 个元素，整数数组按位宽取模（与 JavaScript 相同）
+void typedArraySet(ObjTypedArray *array, int index, double value);
+
 ObjNative *newNative(NativeFn function);
 
 
-// C 语言字符串转为 panda 字符串
-ObjString *takeString(char *chars, int length);
+// 新建一个长度为 length、内容待填充的字符串（尚未计算哈希，也未驻留）
+ObjString *newString(int length);
+
+// 分配能容纳 capacity 个字符的缓冲区，缓冲区前预留了字符串对象头，可以由 takeString 直接转为字符串
+char *allocateStringBuffer(int capacity);
+
+// 调整 allocateStringBuffer 分配的缓冲区的容量，capacity 为 0 时释放
+char *reallocateStringBuffer(char *chars, int oldCapacity, int capacity);
+
+// 接管缓冲区中的 length 个字符，不拷贝地转为字符串（与其他运行时字符串一样不驻留）
+ObjString *takeString(char *chars, int length, int capacity);
+
+ObjStringBuilder *newStringBuilder();
+
+// 返回字符串的哈希值，第一次使用时才计算
+uint32_t stringHash(ObjString *string);
+
+// 返回与 string 内容相同的驻留字符串（用作表的键之前调用）
+ObjString *internString(ObjString *string);
 
 // 拷贝字符串
 ObjString *copyString(const char *chars, int length);
 
+// 不拷贝字符，创建（或找到已驻留的）引用外部字符的字符串，调用方需要保证 owner 可以被 GC 找到
+ObjString *externalString(const char *chars, int length, Obj *owner);
+
+// 短于该长度的子串直接拷贝，不创建视图
+#define STRING_VIEW_MIN_LENGTH 16
+
+// 创建 parent 从 start 开始、长度为 length 的子串（不驻留），较长的子串不拷贝字符
+ObjString *substring(ObjString *parent, int start, int length);
+
 ObjUpvalue *newUpvalue(Value *slot);
 
+// 新建拼接节点，left 与 right 为 ObjString 或 ObjRope
+ObjRope *newRope(Obj *left, Obj *right, int length);
+
+// 展开拼接节点，返回内容相同的字符串（结果会缓存在节点中）
+ObjString *flattenRope(ObjRope *rope);
+
+// 比较两个字符串（ObjString 或 ObjRope）的内容是否相等
+bool stringsEqual(Obj *a, Obj *b);
+
 void printObject(Value value);
 
 // 判断 value的类型是不是type
 static inline bool isObjType(Value value, ObjType type) {
-    return IS_OBJ(value) && AS_OBJ(value)->type == type;
+    return IS_OBJ(value) && OBJ_HEADER_TYPE(AS_OBJ(value)) == type;
 }
 
 #endif //PANDA_OBJECT_H
@@ -0,0 +1,223 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+// pdqsort（pattern-defeating quicksort）模板，由 sort.c 针对每种比较方式包含一次
+// 包含前需要定义 SORT_NAME（生成的函数名前缀）和 SORT_LESS(a, b)（a 是否应排在 b 前面），
+// 生成 SORT_NAME##Sort(begin, end) 和 SORT_NAME##Merge(a, aEnd, b, bEnd, out)；定义了 SORT_NO_MERGE 时不生成 Merge
+// 所有循环都检查边界：脚本比较函数不满足严格弱序时排序结果不确定，但不会越界，也不会丢失元素
+// 没有包含保护，不能作为普通头文件使用
+
+#ifndef SORT_FN
+#define SORT_CONCAT_(a, b) a##b
+#define SORT_CONCAT(a, b) SORT_CONCAT_(a, b)
+#define SORT_FN(name) SORT_CONCAT(SORT_NAME, name)
+// 不超过该长度的区间使用插入排序
+#define SORT_INSERTION_THRESHOLD 24
+// 超过该长度的区间用 9 个元素的中位数作为基准，否则用 3 个元素的中位数
+#define SORT_NINTHER_THRESHOLD 128
+// 部分插入排序最多移动的元素数，超过则认为区间不是基本有序的
+#define SORT_PARTIAL_INSERTION_LIMIT 8
+#define SORT_SWAP(a, b) do { Value swapTemp = (a); (a) = (b); (b) = swapTemp; } while (false)
+#endif
+
+static void SORT_FN(Insertion)(Value *begin, Value *end) {
+    for (Value *current = begin + 1; current < end; current++) {
+        Value value = *current;
+        Value *sift = current;
+        while (sift > begin && SORT_LESS(value, sift[-1])) {
+            *sift = sift[-1];
+            sift--;
+        }
+        *sift = value;
+    }
+}
+
+// 插入排序，移动的元素过多时放弃并返回 false
+static bool SORT_FN(PartialInsertion)(Value *begin, Value *end) {
+    long moved = 0;
+    for (Value *current = begin + 1; current < end; current++) {
+        if (moved > SORT_PARTIAL_INSERTION_LIMIT) return false;
+        Value value = *current;
+        Value *sift = current;
+        while (sift > begin && SORT_LESS(value, sift[-1])) {
+            *sift = sift[-1];
+            sift--;
+        }
+        *sift = value;
+        moved += current - sift;
+    }
+    return true;
+}
+
+static void SORT_FN(SiftDown)(Value *heap, long length, long root) {
+    Value value = heap[root];
+    for (;;) {
+        long child = 2 * root + 1;
+        if (child >= length) break;
+        if (child + 1 < length && SORT_LESS(heap[child], heap[child + 1])) child++;
+        if (!SORT_LESS(value, heap[child])) break;
+        heap[root] = heap[child];
+        root = child;
+    }
+    heap[root] = value;
+}
+
+// 坏的划分过多时退化为堆排序，保证 O(n log n)
+static void SORT_FN(HeapSort)(Value *begin, Value *end) {
+    long length = end - begin;
+    for (long i = length / 2 - 1; i >= 0; i--) {
+        SORT_FN(SiftDown)(begin, length, i);
+    }
+    for (long i = length - 1; i > 0; i--) {
+        SORT_SWAP(begin[0], begin[i]);
+        SORT_FN(SiftDown)(begin, i, 0);
+    }
+}
+
+static void SORT_FN(Sort2)(Value *a, Value *b) {
+    if (SORT_LESS(*b, *a)) SORT_SWAP(*a, *b);
+}
+
+static void SORT_FN(Sort3)(Value *a, Value *b, Value *c) {
+    SORT_FN(Sort2)(a, b);
+    SORT_FN(Sort2)(b, c);
+    SORT_FN(Sort2)(a, b);
+}
+
+// 以 *begin 为基准划分：小于基准的在左，其余在右，返回基准的最终位置
+// alreadyPartitioned 表示划分前就不需要交换任何元素
+static Value *SORT_FN(PartitionRight)(Value *begin, Value *end, bool *alreadyPartitioned) {
+    Value pivot = *begin;
+    Value *first = begin;
+    Value *last = end;
+    while (++first < end && SORT_LESS(*first, pivot));
+    if (first - 1 == begin) {
+        while (first < last && !SORT_LESS(*--last, pivot));
+    } else {
+        while (--last > begin && !SORT_LESS(*last, pivot));
+    }
+    *alreadyPartitioned = first >= last;
+    while (first < last) {
+        SORT_SWAP(*first, *last);
+        while (++first < end && SORT_LESS(*first, pivot));
+        while (--last > begin && !SORT_LESS(*last, pivot));
+    }
+    Value *pivotPosition = first - 1;
+    *begin = *pivotPosition;
+    *pivotPosition = pivot;
+    return pivotPosition;
+}
+
+// 基准等于左边已排好的元素时使用：不大于基准的都放到左边，这些元素不需要再排序
+// 大量重复元素因此只需线性时间
+static Value *SORT_FN(PartitionLeft)(Value *begin, Value *end) {
+    Value pivot = *begin;
+    Value *first = begin;
+    Value *last = end;
+    while (--last > begin && SORT_LESS(pivot, *last));
+    if (last + 1 == end) {
+        while (first < last && !SORT_LESS(pivot, *++first));
+    } else {
+        while (++first < end && !SORT_LESS(pivot, *first));
+    }
+    while (first < last) {
+        SORT_SWAP(*first, *last);
+        while (--last > begin && SORT_LESS(pivot, *last));
+        while (++first < end && !SORT_LESS(pivot, *first));
+    }
+    *begin = *last;
+    *last = pivot;
+    return last;
+}
+
+// badAllowed 为还允许的不平衡划分次数，leftmost 表示 begin 左边没有已排好的元素
+static void SORT_FN(Loop)(Value *begin, Value *end, int badAllowed, bool leftmost) {
+    for (;;) {
+        long size = end - begin;
+        if (size <= SORT_INSERTION_THRESHOLD) {
+            SORT_FN(Insertion)(begin, end);
+            return;
+        }
+
+        // 选择基准并放到 begin
+        long half = size / 2;
+        if (size > SORT_NINTHER_THRESHOLD) {
+            SORT_FN(Sort3)(begin, begin + half, end - 1);
+            SORT_FN(Sort3)(begin + 1, begin + (half - 1), end - 2);
+            SORT_FN(Sort3)(begin + 2, begin + (half + 1), end - 3);
+            SORT_FN(Sort3)(begin + (half - 1), begin + half, begin + (half + 1));
+            SORT_SWAP(begin[0], begin[half]);
+        } else {
+            SORT_FN(Sort3)(begin + half, begin, end - 1);
+        }
+
+        if (!leftmost && !SORT_LESS(begin[-1], *begin)) {
+            begin = SORT_FN(PartitionLeft)(begin, end) + 1;
+            continue;
+        }
+
+        bool alreadyPartitioned;
+        Value *pivot = SORT_FN(PartitionRight)(begin, end, &alreadyPartitioned);
+        long leftSize = pivot - begin;
+        long rightSize = end - (pivot + 1);
+
+        if (leftSize < size / 8 || rightSize < size / 8) {
+            if (--badAllowed == 0) {
+                SORT_FN(HeapSort)(begin, end);
+                return;
+            }
+            // 打乱两侧的部分元素，破坏导致不平衡划分的模式
+            if (leftSize >= SORT_INSERTION_THRESHOLD) {
+                SORT_SWAP(begin[0], begin[leftSize / 4]);
+                SORT_SWAP(pivot[-1], pivot[-leftSize / 4]);
+                if (leftSize > SORT_NINTHER_THRESHOLD) {
+                    SORT_SWAP(begin[1], begin[leftSize / 4 + 1]);
+                    SORT_SWAP(begin[2], begin[leftSize / 4 + 2]);
+                    SORT_SWAP(pivot[-2], pivot[-(leftSize / 4 + 1)]);
+                    SORT_SWAP(pivot[-3], pivot[-(leftSize / 4 + 2)]);
+                }
+            }
+            if (rightSize >= SORT_INSERTION_THRESHOLD) {
+                SORT_SWAP(pivot[1], pivot[1 + rightSize / 4]);
+                SORT_SWAP(end[-1], end[-rightSize / 4]);
+                if (rightSize > SORT_NINTHER_THRESHOLD) {
+                    SORT_SWAP(pivot[2], pivot[2 + rightSize / 4]);
+                    SORT_SWAP(pivot[3], pivot[3 + rightSize / 4]);
+                    SORT_SWAP(end[-2], end[-(1 + rightSize / 4)]);
+                    SORT_SWAP(end[-3], end[-(2 + rightSize / 4)]);
+                }
+            }
+        } else if (alreadyPartitioned && SORT_FN(PartialInsertion)(begin, pivot) &&
+                   SORT_FN(PartialInsertion)(pivot + 1, end)) {
+            // 划分时没有交换，两侧又基本有序：很可能整段已经排好
+            return;
+        }
+
+        // 递归排序左侧，循环处理右侧
+        SORT_FN(Loop)(begin, pivot, badAllowed, leftmost);
+        begin = pivot + 1;
+        leftmost = false;
+    }
+}
+
+static void SORT_FN(Sort)(Value *begin, Value *end) {
+    int badAllowed = 1;
+    for (long size = end - begin; size > 1; size >>= 1) badAllowed++;
+    SORT_FN(Loop)(begin, end, badAllowed, true);
+}
+
+#ifndef SORT_NO_MERGE
+// 归并两个已排好的区间到 out（相等时先取 a 中的元素）
+static void SORT_FN(Merge)(const Value *a, const Value *aEnd, const Value *b, const Value *bEnd, Value *out) {
+    while (a < aEnd && b < bEnd) {
+        *out++ = SORT_LESS(*b, *a) ? *b++ : *a++;
+    }
+    while (a < aEnd) *out++ = *a++;
+    while (b < bEnd) *out++ = *b++;
+}
+#endif
+
+#undef SORT_NAME
+#undef SORT_LESS
+#undef SORT_NO_MERGE
@@ -147,9 +147,17 @@ static TokenType identifierType() {
                 }
             }
             break;
-// if, nil, or, print, return, super
+// if, in, nil, or, print, return, super
         case 'i':
-            return checkKeyword(1, 1, "f", TOKEN_IF);
+            if (scanner.current - scanner.start > 1) {
+                switch (scanner.start[1]) {
+                    case 'f':
+                        return checkKeyword(2, 0, "", TOKEN_IF);
+                    case 'n':
+                        return checkKeyword(2, 0, "", TOKEN_IN);
+                }
+            }
+            break;
         case 'n':
             return checkKeyword(1, 2, "il", TOKEN_NIL);
         case 'o':
@@ -235,20 +243,32 @@ Token scanToken() {
             return makeToken(TOKEN_LEFT_BRACE);
         case '}':
             return makeToken(TOKEN_RIGHT_BRACE);
+        case '[':
+            return makeToken(TOKEN_LEFT_BRACKET);
+        case ']':
+            return makeToken(TOKEN_RIGHT_BRACKET);
         case ';':
             return makeToken(TOKEN_SEMICOLON);
         case ',':
             return makeToken(TOKEN_COMMA);
         case '.':
-            return makeToken(TOKEN_DOT);
+            return makeToken(match('.') ? TOKEN_DOT_DOT : TOKEN_DOT);
+        case ':':
+            return makeToken(TOKEN_COLON);
         case '-':
-            return makeToken(TOKEN_MINUS);
+            if (match('-')) return makeToken(TOKEN_MINUS_MINUS);
+            return makeToken(
+                    match('=') ? TOKEN_MINUS_EQUAL : TOKEN_MINUS);
         case '+':
-            return makeToken(TOKEN_PLUS);
+            if (match('+')) return makeToken(TOKEN_PLUS_PLUS);
+            return makeToken(
+                    match('=') ? TOKEN_PLUS_EQUAL : TOKEN_PLUS);
         case '/':
-            return makeToken(TOKEN_SLASH);
+            return makeToken(
+                    match('=') ? TOKEN_SLASH_EQUAL : TOKEN_SLASH);
         case '*':
-            return makeToken(TOKEN_STAR);
+            return makeToken(
+                    match('=') ? TOKEN_STAR_EQUAL : TOKEN_STAR);
 // != == <= >=
         case '!':
             return makeToken(
@@ -268,3 +288,10 @@ Token scanToken() {
     }
     return errorToken("Unexpected character.");
 }
+
+Token peekToken() {
+    Scanner saved = scanner;
+    Token token = scanToken();
+    scanner = saved;
+    return token;
+}
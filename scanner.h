@@ -2,21 +2,25 @@
 #define clox_scanner_h
 // 关键字枚举
 typedef enum {
-    // (){},.-+;/*
+    // (){}[],. .. :-+;/*
     TOKEN_LEFT_PAREN, TOKEN_RIGHT_PAREN,
     TOKEN_LEFT_BRACE, TOKEN_RIGHT_BRACE,
-    TOKEN_COMMA, TOKEN_DOT, TOKEN_MINUS, TOKEN_PLUS,
+    TOKEN_LEFT_BRACKET, TOKEN_RIGHT_BRACKET,
+    TOKEN_COMMA, TOKEN_DOT, TOKEN_DOT_DOT, TOKEN_COLON, TOKEN_MINUS, TOKEN_PLUS,
     TOKEN_SEMICOLON, TOKEN_SLASH, TOKEN_STAR,
-    // !  !=,  =,  ==,  >,  >=,  <,  <=
+    // !  !=,  =,  ==,  >,  >=,  <,  <=,  +=,  -=,  *=,  /=,  ++,  --
     TOKEN_BANG, TOKEN_BANG_EQUAL,
     TOKEN_EQUAL, TOKEN_EQUAL_EQUAL,
     TOKEN_GREATER, TOKEN_GREATER_EQUAL,
     TOKEN_LESS, TOKEN_LESS_EQUAL,
+    TOKEN_PLUS_EQUAL, TOKEN_MINUS_EQUAL,
+    TOKEN_STAR_EQUAL, TOKEN_SLASH_EQUAL,
+    TOKEN_PLUS_PLUS, TOKEN_MINUS_MINUS,
     // 标识符、字符串、数字
     TOKEN_IDENTIFIER, TOKEN_STRING, TOKEN_NUMBER,
-    // and, class, else, false, for, fun, if, nil, or, print, return, super, this, true, var, while, error, eof
+    // and, class, else, false, for, fun, if, in, nil, or, print, return, super, this, true, var, while, error, eof
     TOKEN_AND, TOKEN_CLASS, TOKEN_ELSE, TOKEN_FALSE,
-    TOKEN_FOR, TOKEN_FUN, TOKEN_IF, TOKEN_NIL, TOKEN_OR,
+    TOKEN_FOR, TOKEN_FUN, TOKEN_IF, TOKEN_IN, TOKEN_NIL, TOKEN_OR,
     TOKEN_PRINT, TOKEN_RETURN, TOKEN_SUPER, TOKEN_THIS,
     TOKEN_TRUE, TOKEN_VAR, TOKEN_WHILE,
     TOKEN_ERROR, TOKEN_EOF
@@ -40,4 +44,7 @@ void initScanner(const char *source);
 // 扫描 token扫描到一个就返回
 Token scanToken();
 
+// 返回下一个 token，但不消耗它（之后的 scanToken 仍然从原来的位置开始）
+Token peekToken();
+
 #endif
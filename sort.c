@@ -0,0 +1,224 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sort.h"
+#include "vm.h"
+
+// 字符串按字节比较，前缀相同时短的在前
+static inline bool stringLess(ObjString *a, ObjString *b) {
+    int length = a->length < b->length ? a->length : b->length;
+    int result = memcmp(a->chars, b->chars, length);
+    return result < 0 || (result == 0 && a->length < b->length);
+}
+
+// 当前的脚本比较函数（位于 sort() 的参数中，GC 可以找到它）
+// 比较函数中可以再次排序，sortList 会保存并恢复这两个变量
+static Value comparator;
+// 比较函数出错后剩下的比较都返回 false，让排序尽快结束
+static bool comparatorFailed;
+
+static bool comparatorLess(Value a, Value b) {
+    if (comparatorFailed) return false;
+    // 多压一份 a 和 b：插入排序等过程中被比较的元素可能只在 C 局部变量中，
+    // 比较函数修改参数后它们仍然能被 GC 找到
+    push(a);
+    push(b);
+    push(comparator);
+    push(a);
+    push(b);
+    if (!callFromNative(2)) {
+        // 运行时错误已经重置了栈
+        comparatorFailed = true;
+        return false;
+    }
+    Value result = pop();
+    vm.stackTop -= 2;
+    if (!IS_NUMBER(result)) {
+        runtimeError("Comparator must return a number.");
+        comparatorFailed = true;
+        return false;
+    }
+    return AS_NUMBER(result) < 0;
+}
+
+#define SORT_NAME int
+#define SORT_LESS(a, b) (AS_INT(a) < AS_INT(b))
+#include "pdqsort.h"
+
+#define SORT_NAME number
+#define SORT_LESS(a, b) (AS_NUMBER(a) < AS_NUMBER(b))
+#include "pdqsort.h"
+
+#define SORT_NAME string
+#define SORT_LESS(a, b) stringLess(AS_STRING(a), AS_STRING(b))
+#include "pdqsort.h"
+
+// 比较函数会调用脚本，只能在当前线程排序，不需要归并
+#define SORT_NAME comparator
+#define SORT_LESS(a, b) comparatorLess(a, b)
+#define SORT_NO_MERGE
+#include "pdqsort.h"
+
+typedef void (*SortFn)(Value *begin, Value *end);
+
+typedef void (*MergeFn)(const Value *a, const Value *aEnd, const Value *b, const Value *bEnd, Value *out);
+
+// 一个线程的工作：merge 为 NULL 时排序 [begin, end)，否则将 [begin, middle) 与 [middle, end) 归并到 out
+typedef struct {
+    SortFn sort;
+    MergeFn merge;
+    Value *begin;
+    Value *middle;
+    Value *end;
+    Value *out;
+} SortTask;
+
+static void *runTask(void *argument) {
+    SortTask *task = argument;
+    if (task->merge == NULL) {
+        task->sort(task->begin, task->end);
+    } else {
+        task->merge(task->begin, task->middle, task->middle, task->end, task->out);
+    }
+    return NULL;
+}
+
+// 第一个任务在当前线程执行，其余各开一个线程；线程创建失败时也在当前线程执行
+static void runTasks(SortTask *tasks, int count) {
+    pthread_t threads[SORT_MAX_THREADS];
+    bool started[SORT_MAX_THREADS];
+    for (int i = 1; i < count; i++) {
+        started[i] = pthread_create(&threads[i], NULL, runTask, &tasks[i]) == 0;
+    }
+    runTask(&tasks[0]);
+    for (int i = 1; i < count; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        } else {
+            runTask(&tasks[i]);
+        }
+    }
+}
+
+static int sortThreads(int count) {
+    if (count < SORT_PARALLEL_THRESHOLD) return 1;
+    long processors = sysconf(_SC_NPROCESSORS_ONLN);
+    if (processors < 1) return 1;
+    return processors < SORT_MAX_THREADS ? (int) processors : SORT_MAX_THREADS;
+}
+
+// 不调用脚本的排序：元素多时每个线程排序一块，再逐轮两两归并相邻的块
+// 排序期间不分配 GC 内存，GC 不会与排序线程同时运行
+static void sortValues(Value *values, int count, SortFn sort, MergeFn merge) {
+    int threads = sortThreads(count);
+    Value *buffer = threads > 1 ? malloc(sizeof(Value) * count) : NULL;
+    if (buffer == NULL) {
+        sort(values, values + count);
+        return;
+    }
+
+    int bounds[SORT_MAX_THREADS + 1];
+    SortTask tasks[SORT_MAX_THREADS];
+    for (int i = 0; i <= threads; i++) {
+        bounds[i] = (int) ((int64_t) count * i / threads);
+    }
+    for (int i = 0; i < threads; i++) {
+        tasks[i] = (SortTask) {sort, NULL, values + bounds[i], NULL, values + bounds[i + 1], NULL};
+    }
+    runTasks(tasks, threads);
+
+    // 每轮归并后块数减半，结果在 values 与 buffer 之间交替
+    Value *from = values;
+    Value *to = buffer;
+    for (int width = 1; width < threads; width *= 2) {
+        int taskCount = 0;
+        for (int i = 0; i < threads; i += 2 * width) {
+            int middle = bounds[i + width < threads ? i + width : threads];
+            int end = bounds[i + 2 * width < threads ? i + 2 * width : threads];
+            tasks[taskCount++] = (SortTask) {sort, merge, from + bounds[i], from + middle, from + end, to + bounds[i]};
+        }
+        runTasks(tasks, taskCount);
+        Value *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != values) memcpy(values, from, sizeof(Value) * count);
+    free(buffer);
+}
+
+// 比较函数可能修改列表，因此在不能被脚本访问的临时列表中排序，结束后再复制回去
+static bool sortWithComparator(ObjList *list, Value function) {
+    int count = list->items.count;
+    ObjList *scratch = newList(count);
+    push(OBJ_VAL(scratch));
+    memcpy(scratch->items.values, list->items.values, sizeof(Value) * count);
+    scratch->items.count = count;
+
+    Value outerComparator = comparator;
+    bool outerFailed = comparatorFailed;
+    comparator = function;
+    comparatorFailed = false;
+    comparatorSort(scratch->items.values, scratch->items.values + count);
+    bool failed = comparatorFailed;
+    comparator = outerComparator;
+    comparatorFailed = outerFailed;
+    if (failed) return false;
+
+    pop();
+    if (list->items.count != count) {
+        runtimeError("List changed size during sort.");
+        return false;
+    }
+    memcpy(list->items.values, scratch->items.values, sizeof(Value) * count);
+    return true;
+}
+
+bool sortList(ObjList *list, Value function) {
+    int count = list->items.count;
+    if (count < 2) return true;
+    if (!IS_NIL(function)) return sortWithComparator(list, function);
+
+    Value *values = list->items.values;
+    bool allInts = true;
+    bool allNumbers = true;
+    bool allStrings = true;
+    for (int i = 0; i < count; i++) {
+        allInts = allInts && IS_INT(values[i]);
+        allNumbers = allNumbers && IS_NUMBER(values[i]);
+        allStrings = allStrings && IS_ANY_STRING(values[i]);
+    }
+
+    if (allInts) {
+        sortValues(values, count, intSort, intMerge);
+    } else if (allNumbers) {
+        // NaN 与任何数比较都为 false，不满足严格弱序，先移到末尾
+        int end = count;
+        for (int i = 0; i < end;) {
+            if (isnan(AS_NUMBER(values[i]))) {
+                Value nan = values[i];
+                values[i] = values[--end];
+                values[end] = nan;
+            } else {
+                i++;
+            }
+        }
+        sortValues(values, end, numberSort, numberMerge);
+    } else if (allStrings) {
+        // 先展开 rope（列表的元素在分配内存期间都能被 GC 找到）
+        for (int i = 0; i < count; i++) {
+            if (IS_ROPE(values[i])) values[i] = OBJ_VAL(flattenRope(AS_ROPE(values[i])));
+        }
+        sortValues(values, count, stringSort, stringMerge);
+    } else {
+        runtimeError("Can only sort numbers or strings without a comparator.");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,18 @@
+//
+// Created by 臧帅 on 24-7-9.
+//
+
+#ifndef PANDA_SORT_H
+#define PANDA_SORT_H
+
+#include "common.h"
+#include "object.h"
+
+// 原地排序列表（不稳定）
+// comparator 为 nil 时元素必须都是数字（NaN 排在最后）或都是字符串（按字节比较），不调用脚本；
+// 元素足够多时分块并行排序再归并
+// 否则调用 comparator(a, b)，返回负数表示 a 应排在 b 前面；比较期间列表长度被修改时报错
+// 出错时已经报告运行时错误，返回 false
+bool sortList(ObjList *list, Value comparator);
+
+#endif //PANDA_SORT_H
@@ -10,102 +10,275 @@
 #include "table.h"
 #include "value.h"
 
-#define TABLE_MAX_LOAD 0.75
+// 键值对与墓碑合计不超过槽位的 7/8
+#define TABLE_MAX_LOAD(capacity) ((capacity) / 8 * 7)
+// 扩容后每次操作从旧数组搬移的槽位数
+#define TABLE_MIGRATE_SLOTS (TABLE_GROUP_SIZE * 2)
+// 键值对少于槽位的 1/16 时收缩，收缩后装载率不超过 1/4（扩容在 7/16 时发生，两者之间留有余量，避免反复调整）
+#define TABLE_SHRINK_LOAD(capacity) ((capacity) / 16)
+#define TABLE_SHRUNK_LOAD(capacity) ((capacity) / 4)
+// 新数组中的墓碑超过槽位的 1/4 时原容量重建
+#define TABLE_MAX_TOMBSTONES(capacity) ((capacity) / 4)
 
-// 初始化 hash 表
+// 一次分配的大小：控制字节、键数组、值数组（字符串集合没有值数组）
+static size_t tableBlockSize(int capacity, bool withValues) {
+    return (size_t) capacity * (sizeof(uint8_t) + sizeof(REF(ObjString)) + (withValues ? sizeof(Value) : 0));
+}
+
+// 初始化 hash 表（空表为小表）
 void initTable(Table *table) {
     table->count = 0;
     table->capacity = 0;
-    table->entries = NULL;
+}
+
+// 是否有正在进行的搬移
+static inline bool isMigrating(Table *table) {
+    return !TABLE_IS_INLINE(table) && table->oldControl != NULL;
+}
+
+// 释放新旧两组槽位数组，回到空的小表
+static void freeSlots(Table *table, bool withValues) {
+    if (!TABLE_IS_INLINE(table)) {
+        reallocate(table->control, tableBlockSize(table->capacity, withValues), 0);
+        if (table->oldControl != NULL) {
+            reallocate(table->oldControl, tableBlockSize(table->oldCapacity, withValues), 0);
+        }
+    }
+    initTable(table);
 }
 
 // 销毁 hash 表
 void freeTable(Table *table) {
-    FREE_ARRAY(Entry, table->entries, table->capacity);
-    initTable(table);
+    freeSlots(table, true);
 }
 
-// 查询要找的 entry，传入为：初始 entry，容量大小，要查找到的 key
-static Entry *findEntry(Entry *entries, int capacity,
-                        ObjString *key) {
-    // 获取到该值在哪个索引中
-    uint32_t index = key->hash % capacity;
-    //
-    Entry *tombstone = NULL;
-
-    for (;;) {
-        // 获取该索引
-        Entry *entry = &entries[index];
-        // 正确处理墓碑（）
-        if (entry->key == NULL) {
-            // key 为 NULL，值为 NIL，说明这不是墓碑，就是空的，墓碑为空返回 NIL，否则返回上一个空墓碑（用于插入使用）
-            if (IS_NIL(entry->value)) {
-                return tombstone != NULL ? tombstone : entry;
-            }
-                // key 为 NULL，值为 BOOL_TRUE，说明这是个墓碑，继续寻找，tombstone标记这个墓碑
-            else {
-                if (tombstone == NULL) tombstone = entry;
-            }
-        } else if (entry->key == key) {
-            // 如果找到了 key 就返回
-            return entry;
+// 在小表中查找 key，找不到返回 -1
+static inline int findInline(Table *table, ObjString *key) {
+    REF(ObjString) keyRef = TO_REF(key);
+    for (int i = 0; i < table->count; i++) {
+        if (table->inlineKeys[i] == keyRef) return i;
+    }
+    return -1;
+}
+
+// 在一组槽位数组中查找 key 所在的槽位，找不到返回 -1
+// 按组探测：组内先用控制字节筛选，组里有空槽说明 key 不可能在后面的组
+static int findSlot(uint8_t *control, int capacity, ObjString *key) {
+    REF(ObjString) *keys = TABLE_KEYS(control, capacity);
+    uint32_t groupMask = (uint32_t) (capacity / TABLE_GROUP_SIZE - 1);
+    uint32_t group = TABLE_H1(key->hash) & groupMask;
+    uint8_t h2 = TABLE_H2(key->hash);
+    REF(ObjString) keyRef = TO_REF(key);
+    for (uint32_t step = 1;; step++) {
+        int base = (int) group * TABLE_GROUP_SIZE;
+        for (uint32_t match = tableMatchByte(control + base, h2); match != 0; match &= match - 1) {
+            int slot = base + __builtin_ctz(match);
+            if (keys[slot] == keyRef) return slot;
         }
-        index = (index + 1) % capacity;
+        if (tableMatchByte(control + base, TABLE_EMPTY) != 0) return -1;
+        // 三角数步长，组数为 2 的幂时能走遍所有组
+        group = (group + step) & groupMask;
     }
 }
 
-// 调整 hash 容量
-static void adjustCapacity(Table *table, int capacity) {
-    // 在堆上分配一个新数组，然后转为Entry类型，长度为capacity
-    Entry *entries = ALLOCATE(Entry, capacity);
-    // 设置初始值
-    for (int i = 0; i < capacity; i++) {
-        entries[i].key = NULL;
-        entries[i].value = NIL_VAL;
+// 找到 hash 对应的第一个空槽或墓碑，用于插入
+static int findFreeSlot(uint8_t *control, int capacity, uint32_t hash) {
+    uint32_t groupMask = (uint32_t) (capacity / TABLE_GROUP_SIZE - 1);
+    uint32_t group = TABLE_H1(hash) & groupMask;
+    for (uint32_t step = 1;; step++) {
+        int base = (int) group * TABLE_GROUP_SIZE;
+        uint32_t match = tableMatchFree(control + base);
+        if (match != 0) return base + __builtin_ctz(match);
+        group = (group + step) & groupMask;
     }
-    table->count = 0;
-    // 将原始 hash 表中的值插入到新的表中
-    for (int i = 0; i < table->capacity; i++) {
-        Entry *entry = &table->entries[i];
-        // 不移植墓碑
-        if (entry->key == NULL) continue;
-        Entry *dest = findEntry(entries, capacity, entry->key);
-        dest->key = entry->key;
-        dest->value = entry->value;
-        table->count++;
-    }
-    // 销毁原表
-    FREE_ARRAY(Entry, table->entries, table->capacity);
-    table->entries = entries;
+}
+
+// 将旧数组中的 slots 个槽位搬到新数组，全部搬完后释放旧数组
+// 搬走的槽位留下墓碑，保证查找先查新数组、再查旧数组时不会找到过期的副本
+static void migrate(Table *table, int slots, bool withValues) {
+    uint8_t *oldControl = table->oldControl;
+    REF(ObjString) *oldKeys = TABLE_KEYS(oldControl, table->oldCapacity);
+    Value *oldValues = TABLE_VALUES(oldControl, table->oldCapacity);
+    REF(ObjString) *keys = TABLE_KEYS(table->control, table->capacity);
+    Value *values = TABLE_VALUES(table->control, table->capacity);
+    int end = table->migrated + slots;
+    if (end > table->oldCapacity) end = table->oldCapacity;
+    for (int i = table->migrated; i < end; i++) {
+        if (oldControl[i] & 0x80) continue;
+        int slot = findFreeSlot(table->control, table->capacity, FROM_REF(ObjString, oldKeys[i])->hash);
+        if (table->control[slot] == TABLE_DELETED) table->tombstones--;
+        table->control[slot] = oldControl[i];
+        keys[slot] = oldKeys[i];
+        if (withValues) values[slot] = oldValues[i];
+        oldControl[i] = TABLE_DELETED;
+    }
+    table->migrated = end;
+    if (end == table->oldCapacity) {
+        reallocate(oldControl, tableBlockSize(table->oldCapacity, withValues), 0);
+        table->oldControl = NULL;
+        table->oldCapacity = 0;
+        table->migrated = 0;
+    }
+}
+
+// 调整 hash 容量（容量不变时只清除墓碑），只用于已经转为哈希表的表
+// 不一次性重新插入所有键值对：当前数组变为旧数组，之后的每次操作搬移一部分
+static void adjustCapacity(Table *table, int capacity, bool withValues) {
+    // 上一次调整还没搬完时先搬完，同一时间最多只有一个旧数组
+    if (table->oldControl != NULL) migrate(table, table->oldCapacity, withValues);
+    // 先分配新数组：分配可能触发 GC，此时旧表还要能正常使用
+    uint8_t *control = ALLOCATE(uint8_t, tableBlockSize(capacity, withValues));
+    memset(control, TABLE_EMPTY, capacity);
+    if (table->count == 0) {
+        // 没有键值对需要搬移（只有墓碑），直接丢弃旧数组
+        reallocate(table->control, tableBlockSize(table->capacity, withValues), 0);
+    } else {
+        table->oldControl = table->control;
+        table->oldCapacity = table->capacity;
+        table->migrated = 0;
+    }
+    table->control = control;
     table->capacity = capacity;
+    table->tombstones = 0;
+}
+
+// 小表转为哈希表（键值对已满时调用）
+static void inflate(Table *table, bool withValues) {
+    // 先分配数组：分配可能触发 GC，此时小表还要能正常使用
+    uint8_t *control = ALLOCATE(uint8_t, tableBlockSize(TABLE_GROUP_SIZE, withValues));
+    memset(control, TABLE_EMPTY, TABLE_GROUP_SIZE);
+    // 小表的键值对与哈希表的字段共用内存，先全部取出
+    int count = table->count;
+    REF(ObjString) keys[TABLE_INLINE_CAPACITY];
+    Value values[TABLE_INLINE_CAPACITY];
+    memcpy(keys, table->inlineKeys, sizeof(keys));
+    if (withValues) memcpy(values, table->inlineValues, sizeof(values));
+
+    table->capacity = TABLE_GROUP_SIZE;
+    table->tombstones = 0;
+    table->oldCapacity = 0;
+    table->migrated = 0;
+    table->control = control;
+    table->oldControl = NULL;
+    for (int i = 0; i < count; i++) {
+        uint32_t hash = FROM_REF(ObjString, keys[i])->hash;
+        int slot = findFreeSlot(control, TABLE_GROUP_SIZE, hash);
+        control[slot] = TABLE_H2(hash);
+        TABLE_KEYS(control, TABLE_GROUP_SIZE)[slot] = keys[i];
+        if (withValues) TABLE_VALUES(control, TABLE_GROUP_SIZE)[slot] = values[i];
+    }
+}
+
+// 哈希表退回小表（键值对不多于 TABLE_INLINE_CAPACITY 个时调用），不分配内存
+static void deflate(Table *table, bool withValues) {
+    if (table->oldControl != NULL) migrate(table, table->oldCapacity, withValues);
+    uint8_t *control = table->control;
+    int capacity = table->capacity;
+    int count = 0;
+    REF(ObjString) keys[TABLE_INLINE_CAPACITY];
+    Value values[TABLE_INLINE_CAPACITY];
+    for (int i = 0; i < capacity; i++) {
+        if (!TABLE_IS_FULL(control, i)) continue;
+        keys[count] = TABLE_KEYS(control, capacity)[i];
+        if (withValues) values[count] = TABLE_VALUES(control, capacity)[i];
+        count++;
+    }
+    reallocate(control, tableBlockSize(capacity, withValues), 0);
+
+    table->capacity = 0;
+    memcpy(table->inlineKeys, keys, sizeof(keys));
+    if (withValues) memcpy(table->inlineValues, values, sizeof(values));
+}
+
+// 删除后调用：键值对降到低水位以下时收缩（很少时退回小表），新数组中墓碑过多时原容量重建
+static void compact(Table *table, bool withValues) {
+    if (TABLE_IS_INLINE(table)) return;
+    if (table->count < TABLE_SHRINK_LOAD(table->capacity)) {
+        if (table->count <= TABLE_INLINE_CAPACITY / 2) {
+            deflate(table, withValues);
+            return;
+        }
+        int capacity = TABLE_GROUP_SIZE;
+        while (table->count > TABLE_SHRUNK_LOAD(capacity)) capacity *= 2;
+        adjustCapacity(table, capacity, withValues);
+    } else if (table->tombstones > TABLE_MAX_TOMBSTONES(table->capacity) && table->oldControl == NULL) {
+        adjustCapacity(table, table->capacity, withValues);
+    }
+}
+
+// 查找 key 对应的值，先查新数组、再查旧数组，找不到返回 NULL
+static Value *findValue(Table *table, ObjString *key) {
+    if (TABLE_IS_INLINE(table)) {
+        int i = findInline(table, key);
+        return i == -1 ? NULL : &table->inlineValues[i];
+    }
+    int slot = findSlot(table->control, table->capacity, key);
+    if (slot != -1) return &TABLE_VALUES(table->control, table->capacity)[slot];
+    if (table->oldControl != NULL) {
+        int slot = findSlot(table->oldControl, table->oldCapacity, key);
+        if (slot != -1) return &TABLE_VALUES(table->oldControl, table->oldCapacity)[slot];
+    }
+    return NULL;
+}
+
+// 插入一个不在表中的键，返回存放它的值的位置（字符串集合没有值，返回 NULL）
+static Value *insertKey(Table *table, ObjString *key, bool withValues) {
+    if (TABLE_IS_INLINE(table)) {
+        if (table->count < TABLE_INLINE_CAPACITY) {
+            int i = table->count++;
+            table->inlineKeys[i] = TO_REF(key);
+            return withValues ? &table->inlineValues[i] : NULL;
+        }
+        inflate(table, withValues);
+    }
+    // 检测是否需要调整容量：键值对较多时扩容，否则只是墓碑太多，原容量重建即可
+    // 旧数组中还没搬移的键值对也算在 count 中，保证新数组装得下
+    if (table->count + table->tombstones + 1 > TABLE_MAX_LOAD(table->capacity)) {
+        int capacity = table->capacity;
+        if (table->count + 1 > TABLE_MAX_LOAD(capacity) / 2) capacity *= 2;
+        adjustCapacity(table, capacity, withValues);
+    }
+    int slot = findFreeSlot(table->control, table->capacity, key->hash);
+    if (table->control[slot] == TABLE_DELETED) table->tombstones--;
+    table->control[slot] = TABLE_H2(key->hash);
+    TABLE_KEYS(table->control, table->capacity)[slot] = TO_REF(key);
+    table->count++;
+    return withValues ? &TABLE_VALUES(table->control, table->capacity)[slot] : NULL;
 }
 
 // 将给定的键/值对添加到给定的哈希表中。如果该键的条目已存在，新值将覆盖旧值。如果添加了新条目，则该函数返回`true`。
 bool tableSet(Table *table, ObjString *key, Value value) {
-    // 检测是否需要调整容量
-    if (table->count + 1 > table->capacity * TABLE_MAX_LOAD) {
-        int capacity = GROW_CAPACITY(table->capacity);
-        adjustCapacity(table, capacity);
-    }
-    // 查找键值对
-    Entry *entry = findEntry(table->entries, table->capacity, key);
-    // 是否找到值
-    bool isNewKey = entry->key == NULL;
-    // 如果没有找到值，但是找到了相关键，则插入
-    if (isNewKey && IS_NIL(entry->value)) table->count++;
-
-    entry->key = key;
-    entry->value = value;
-    return isNewKey;
-}
-
-// 哈希表的所有条目复制到另一个哈希表中
-void tableAddAll(Table *from, Table *to) {
-    for (int i = 0; i < from->capacity; i++) {
-        Entry *entry = &from->entries[i];
-        if (entry->key != NULL) {
-            tableSet(to, entry->key, entry->value);
+    if (isMigrating(table)) migrate(table, TABLE_MIGRATE_SLOTS, true);
+    if (table->count > 0) {
+        Value *existing = findValue(table, key);
+        if (existing != NULL) {
+            *existing = value;
+            return false;
+        }
+    }
+    *insertKey(table, key, true) = value;
+    return true;
+}
+
+// 在一组槽位数组中查找字符串
+static ObjString *findString(uint8_t *control, int capacity, const char *chars, int length, uint32_t hash) {
+    uint32_t groupMask = (uint32_t) (capacity / TABLE_GROUP_SIZE - 1);
+    uint32_t group = TABLE_H1(hash) & groupMask;
+    uint8_t h2 = TABLE_H2(hash);
+    for (uint32_t step = 1;; step++) {
+        int base = (int) group * TABLE_GROUP_SIZE;
+        for (uint32_t match = tableMatchByte(control + base, h2); match != 0; match &= match - 1) {
+            ObjString *key = TABLE_KEY(control, capacity, base + __builtin_ctz(match));
+            if (key->length == length &&
+                key->hash == hash &&
+                memcmp(key->chars, chars, length) == 0) {
+                // 找到字符串
+                return key;
+            }
         }
+        // 遇到空槽则返回空
+        if (tableMatchByte(control + base, TABLE_EMPTY) != 0) return NULL;
+        group = (group + step) & groupMask;
     }
 }
 
@@ -113,67 +286,153 @@ void tableAddAll(Table *from, Table *to) {
 ObjString *tableFindString(Table *table, const char *chars,
                            int length, uint32_t hash) {
     if (table->count == 0) return NULL;
-
-    uint32_t index = hash % table->capacity;
-    for (;;) {
-        Entry *entry = &table->entries[index];
-        if (entry->key == NULL) {
-            // 遇到墓碑则返回空
-            if (IS_NIL(entry->value)) return NULL;
-        } else if (entry->key->length == length &&
-                   entry->key->hash == hash &&
-                   memcmp(entry->key->chars, chars, length) == 0) {
-            // 找到字符串
-            return entry->key;
+    if (TABLE_IS_INLINE(table)) {
+        for (int i = 0; i < table->count; i++) {
+            ObjString *key = FROM_REF(ObjString, table->inlineKeys[i]);
+            if (key->length == length && key->hash == hash && memcmp(key->chars, chars, length) == 0) return key;
         }
+        return NULL;
+    }
+    ObjString *key = findString(table->control, table->capacity, chars, length, hash);
+    if (key == NULL && table->oldControl != NULL) {
+        key = findString(table->oldControl, table->oldCapacity, chars, length, hash);
+    }
+    return key;
+}
 
-        index = (index + 1) % table->capacity;
+// 删除新数组中的一个槽位
+static void deleteSlot(Table *table, int slot) {
+    // 组里原本就有空槽时，没有查找会越过这一组，可以直接置空；否则留下墓碑
+    int base = slot & ~(TABLE_GROUP_SIZE - 1);
+    if (tableMatchByte(table->control + base, TABLE_EMPTY) != 0) {
+        table->control[slot] = TABLE_EMPTY;
+    } else {
+        table->control[slot] = TABLE_DELETED;
+        table->tombstones++;
     }
+    table->count--;
+}
+
+// 删除旧数组中的一个槽位，旧数组不再插入，只需留下墓碑
+static void deleteOldSlot(Table *table, int slot) {
+    table->oldControl[slot] = TABLE_DELETED;
+    table->count--;
 }
 
+// 删除小表中的第 i 个键值对，用最后一个填补空位
+static void deleteInline(Table *table, int i, bool withValues) {
+    int last = --table->count;
+    table->inlineKeys[i] = table->inlineKeys[last];
+    if (withValues) table->inlineValues[i] = table->inlineValues[last];
+}
 
-// 垃圾回收时使用，删除这个表中，没有被标记删除的元素
-void tableRemoveWhite(Table *table) {
-    for (int i = 0; i < table->capacity; i++) {
-        Entry *entry = &table->entries[i];
-        if (entry->key != NULL && !entry->key->obj.isMarked) {
-            tableDelete(table, entry->key);
-        }
+// GCC 12.2（Debian 12.2.0-14，-O2）会把下面循环里的槽位地址经 ivopts 改写成以 0 为基址的 MEM[0B + ...]，
+// 随后 local-pure-const 把它当成空指针解引用，认为调用 markObject 的分支不可达，把 markSlots 判定为 pure，
+// markTable 里的两次调用接着在 dce2 中被删掉，槽位数组里的键和值都不会被标记。
+// -fdump-tree-local-pure-const2-details 里能看到 "NULL memory access; terminating BB"。
+// noipa 让调用方不使用对 markSlots 推断出的属性，test/gc_table_mark.lox 在 -O2 下覆盖这种情况
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 8
+#define MARK_NO_IPA __attribute__((noipa))
+#else
+#define MARK_NO_IPA
+#endif
+
+// 标记一个槽位数组里的键和值
+MARK_NO_IPA static void markSlots(uint8_t *control, int capacity) {
+    for (int i = 0; i < capacity; i++) {
+        if (!TABLE_IS_FULL(control, i)) continue;
+        markObject((Obj *) TABLE_KEY(control, capacity, i));
+        markValue(TABLE_VALUES(control, capacity)[i]);
     }
 }
 
-// 遍历，分别标记里面的键和值
+// 遍历，分别标记里面的键和值（搬移过程中新旧数组都要标记）
 void markTable(Table *table) {
-    for (int i = 0; i < table->capacity; i++) {
-        Entry *entry = &table->entries[i];
-        markObject((Obj *) entry->key);
-        markValue(entry->value);
+    if (TABLE_IS_INLINE(table)) {
+        for (int i = 0; i < table->count; i++) {
+            markObject((Obj *) FROM_REF(ObjString, table->inlineKeys[i]));
+            markValue(table->inlineValues[i]);
+        }
+        return;
     }
+    markSlots(table->control, table->capacity);
+    markSlots(table->oldControl, table->oldCapacity);
 }
 // 从 hash 查询值，将查到的值存入 value 中
 bool tableGet(Table *table, ObjString *key, Value *value) {
     // 如果表为空，则返回 false
     if (table->count == 0) return false;
+    if (isMigrating(table)) migrate(table, TABLE_MIGRATE_SLOTS, true);
     // 找到目前是否已经存在这个 key
-    Entry *entry = findEntry(table->entries, table->capacity, key);
-
+    Value *found = findValue(table, key);
     // 如果没有找到，则返回错误
-    if (entry->key == NULL) return false;
+    if (found == NULL) return false;
 
-    *value = entry->value;
+    *value = *found;
     return true;
 }
+Value *tableGetSlot(Table *table, ObjString *key) {
+    if (table->count == 0) return NULL;
+    if (isMigrating(table)) migrate(table, TABLE_MIGRATE_SLOTS, true);
+    return findValue(table, key);
+}
+// 删除小表、新数组或旧数组中的 key
+static bool deleteKey(Table *table, ObjString *key, bool withValues) {
+    if (TABLE_IS_INLINE(table)) {
+        int i = findInline(table, key);
+        if (i == -1) return false;
+        deleteInline(table, i, withValues);
+        return true;
+    }
+    int slot = findSlot(table->control, table->capacity, key);
+    if (slot != -1) {
+        deleteSlot(table, slot);
+        return true;
+    }
+    if (table->oldControl != NULL) {
+        slot = findSlot(table->oldControl, table->oldCapacity, key);
+        if (slot != -1) {
+            deleteOldSlot(table, slot);
+            return true;
+        }
+    }
+    return false;
+}
+
 // 删除表中的 key 元素
 bool tableDelete(Table *table, ObjString *key) {
     if (table->count == 0) return false;
+    if (isMigrating(table)) migrate(table, TABLE_MIGRATE_SLOTS, true);
+    if (!deleteKey(table, key, true)) return false;
+    compact(table, true);
+    return true;
+}
 
-    // 找到这个 entry
-    Entry *entry = findEntry(table->entries, table->capacity, key);
-    // 如果没有找到则返回 false
-    if (entry->key == NULL) return false;
+void initStringSet(StringSet *set) {
+    initTable(&set->slots);
+}
 
-    // 将该值替换为一个墓碑
-    entry->key = NULL;
-    entry->value = BOOL_VAL(true);
-    return true;
-}
\ No newline at end of file
+void freeStringSet(StringSet *set) {
+    freeSlots(&set->slots, false);
+}
+
+ObjString *stringSetFind(StringSet *set, const char *chars, int length, uint32_t hash) {
+    return tableFindString(&set->slots, chars, length, hash);
+}
+
+// 加入字符串（调用方保证集合中没有相同内容的字符串）
+void stringSetAdd(StringSet *set, ObjString *string) {
+    Table *slots = &set->slots;
+    if (isMigrating(slots)) migrate(slots, TABLE_MIGRATE_SLOTS, false);
+    // 删除发生在 sweep 中，不能分配内存：大量字符串被回收后，在下一次加入时再收缩
+    compact(slots, false);
+    insertKey(slots, string, false);
+}
+
+// 删除字符串（在 sweep 释放驻留字符串时调用，不需要扫描整个集合）
+void stringSetRemove(StringSet *set, ObjString *string) {
+    Table *slots = &set->slots;
+    if (slots->count == 0) return;
+    if (isMigrating(slots)) migrate(slots, TABLE_MIGRATE_SLOTS, false);
+    deleteKey(slots, string, false);
+}
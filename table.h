@@ -7,36 +7,115 @@
 
 #include "common.h"
 #include "value.h"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-typedef struct {
-    ObjString *key;
-    Value value;
-} Entry;
+// 每组槽位数，查找时一次比较一组控制字节
+#define TABLE_GROUP_SIZE 16
+// 控制字节：最高位为 1 表示空槽或墓碑，否则为键的哈希值的低 7 位
+#define TABLE_EMPTY   ((uint8_t) 0x80)
+#define TABLE_DELETED ((uint8_t) 0xfe)
+// 哈希值的高位决定从哪一组开始探测，低 7 位存入控制字节
+#define TABLE_H1(hash) ((hash) >> 7)
+#define TABLE_H2(hash) ((uint8_t) ((hash) & 0x7f))
+
+// 一组控制字节中等于 byte 的槽位（第 i 位对应组内第 i 个槽位）
+static inline uint32_t tableMatchByte(const uint8_t *group, uint8_t byte) {
+#ifdef __SSE2__
+    __m128i control = _mm_loadu_si128((const __m128i *) group);
+    return (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8((char) byte)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < TABLE_GROUP_SIZE; i++) {
+        if (group[i] == byte) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
 
+// 一组控制字节中的空槽或墓碑（最高位为 1）
+static inline uint32_t tableMatchFree(const uint8_t *group) {
+#ifdef __SSE2__
+    return (uint32_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i *) group));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < TABLE_GROUP_SIZE; i++) {
+        if (group[i] & 0x80) mask |= 1u << i;
+    }
+    return mask;
+#endif
+}
 
+// 小表直接存放在 Table 结构体中的键值对数量上限，超过后才转为哈希表
+#define TABLE_INLINE_CAPACITY 4
+
+// 哈希表：控制字节、键、值分别存放在三个数组中（同一次分配，键和值数组紧跟在控制字节后面）
+// 扩容时不一次性搬移：旧数组保留到所有键值对都搬到新数组为止，查找时两个数组都要查
+// 键值对不多于 TABLE_INLINE_CAPACITY 个时（capacity 为 0）不分配数组，键值对依次存放在表内，按指针逐个比较键
 typedef struct {
+    // 键值对数量（包括旧数组中还没搬移的）
     int count;
+    // 槽位数，为 0（小表）或 TABLE_GROUP_SIZE 以上的 2 的幂
     int capacity;
-    Entry *entries;
+    union {
+        struct {
+            // 新数组中的墓碑数量，墓碑同样占用装载率
+            int tombstones;
+            // 旧数组的槽位数，没有正在进行的搬移时为 0
+            int oldCapacity;
+            // 旧数组中已经搬移到的位置
+            int migrated;
+            uint8_t *control;
+            uint8_t *oldControl;
+        };
+        // 小表的前 count 个键值对
+        struct {
+            REF(ObjString) inlineKeys[TABLE_INLINE_CAPACITY];
+            Value inlineValues[TABLE_INLINE_CAPACITY];
+        };
+    };
 } Table;
-
 void initTable(Table *table);
 
 void freeTable(Table *table);
+// 控制字节后面的键数组和值数组
+#define TABLE_KEYS(control, capacity)   ((REF(ObjString) *) ((control) + (capacity)))
+#define TABLE_VALUES(control, capacity) ((Value *) (TABLE_KEYS(control, capacity) + (capacity)))
+// 第 i 个槽位是否存有键值对
+#define TABLE_IS_FULL(control, i) ((control)[i] < 0x80)
+// 读取第 i 个槽位的键
+#define TABLE_KEY(control, capacity, i) FROM_REF(ObjString, TABLE_KEYS(control, capacity)[i])
+// 是否为小表（键值对存放在表内）
+#define TABLE_IS_INLINE(table) ((table)->capacity == 0)
+
 // 插入值
 bool tableSet(Table *table, ObjString *key, Value value);
 
-// 哈希表的所有条目复制到另一个哈希表中
-void tableAddAll(Table *from, Table *to);
-
 ObjString *tableFindString(Table *table, const char *chars, int length, uint32_t hash);
 
-void tableRemoveWhite(Table *table);
-
 void markTable(Table *table);
 // 检索值，将查到的值存入 value 中
 bool tableGet(Table *table, ObjString *key, Value *value);
+// 返回 key 对应的值在表中的位置，找不到返回 NULL；表被修改前一直有效，可以原地更新
+Value *tableGetSlot(Table *table, ObjString *key);
 // 删除表中的 key 元素
 bool tableDelete(Table *table, ObjString *key);
 
+// 字符串驻留集合：与 Table 使用相同的槽位结构，但只存键，不分配值数组
+typedef struct {
+    Table slots;
+} StringSet;
+
+void initStringSet(StringSet *set);
+
+void freeStringSet(StringSet *set);
+
+// 查找内容相同的字符串
+ObjString *stringSetFind(StringSet *set, const char *chars, int length, uint32_t hash);
+
+void stringSetAdd(StringSet *set, ObjString *string);
+
+void stringSetRemove(StringSet *set, ObjString *string);
+
 #endif //PANDA_TABLE_H
@@ -3,6 +3,7 @@
 //
 
 #include "value.h"
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 #include "object.h"
@@ -34,8 +35,53 @@ void freeValueArray(ValueArray *array) {
     initValueArray(array);
 }
 
+// 输出小整数。%g 最多保留 6 位有效数字，范围内的整数用 %d 输出结果相同且更快，范围外仍交给 %g 保证与 double 输出一致
+static void printInt(int32_t value) {
+    if (value > -1000000 && value < 1000000) {
+        printf("%d", value);
+    } else {
+        printf("%g", (double) value);
+    }
+}
+
+// 将数字格式化为文本。%g 能精确输出的整数值直接逐位转换，不经过 printf
+int formatNumber(Value value, char *buffer) {
+    double number = AS_NUMBER(value);
+    if (number > -1000000 && number < 1000000 && number == (int32_t) number && !signbit(number)) {
+        char digits[8];
+        int count = 0;
+        uint32_t magnitude = (uint32_t) number;
+        do {
+            digits[count++] = (char) ('0' + magnitude % 10);
+            magnitude /= 10;
+        } while (magnitude > 0);
+        int length = 0;
+        while (count > 0) buffer[length++] = digits[--count];
+        buffer[length] = '\0';
+        return length;
+    }
+    if (number > -1000000 && number < 0 && number == (int32_t) number) {
+        buffer[0] = '-';
+        return 1 + formatNumber(NUMBER_VAL(-number), buffer + 1);
+    }
+    return snprintf(buffer, NUMBER_BUFFER_SIZE, "%g", number);
+}
+
 // 输出常量池中的数据的值，其中要将 value 值转为 C 语言的值（debug 时使用）
 void printValue(Value value) {
+#ifdef NAN_BOXING
+    if (IS_BOOL(value)) {
+        printf(AS_BOOL(value) ? "true" : "false");
+    } else if (IS_NIL(value)) {
+        printf("nil");
+    } else if (IS_INT(value)) {
+        printInt(AS_INT(value));
+    } else if (IS_NUMBER(value)) {
+        printf("%g", AS_NUMBER(value));
+    } else if (IS_OBJ(value)) {
+        printObject(value);
+    }
+#else
     switch (value.type) {
         case VAL_BOOL:
             printf(AS_BOOL(value) ? "true" : "false");
@@ -46,13 +92,38 @@ void printValue(Value value) {
         case VAL_NUMBER:
             printf("%g", AS_NUMBER(value));
             break;
+        case VAL_INT:
+            printInt(AS_INT(value));
+            break;
         case VAL_OBJ:
             printObject(value);
             break;
     }
+#endif
 }
 // 判断两个 Value 值是否相等
 bool valuesEqual(Value a, Value b) {
+#ifdef NAN_BOXING
+    // 数字需要按 IEEE 754 比较（NaN != NaN），其余值比较位模式即可
+    if (IS_INT(a) && IS_INT(b)) return a == b;
+    if (IS_NUMBER(a) && IS_NUMBER(b)) {
+        return AS_NUMBER(a) == AS_NUMBER(b);
+    }
+    // 字符串未必都已驻留，需要比较内容
+    if (a != b && IS_ANY_STRING(a) && IS_ANY_STRING(b)) {
+        return stringsEqual(AS_OBJ(a), AS_OBJ(b));
+    }
+    return a == b;
+#else
+    // 小整数与 double 只是同一个数字的两种表示
+    if (IS_NUMBER(a) && IS_NUMBER(b)) {
+        if (IS_INT(a) && IS_INT(b)) return AS_INT(a) == AS_INT(b);
+        return AS_NUMBER(a) == AS_NUMBER(b);
+    }
+    // 字符串未必都已驻留，需要比较内容
+    if (IS_ANY_STRING(a) && IS_ANY_STRING(b)) {
+        return stringsEqual(AS_OBJ(a), AS_OBJ(b));
+    }
     if (a.type != b.type) return false;
     switch (a.type) {
         case VAL_BOOL:
@@ -67,4 +138,12 @@ bool valuesEqual(Value a, Value b) {
         default:
             return false; // Unreachable.
     }
-}
\ No newline at end of file
+#endif
+}
+
+uint32_t numberToUint32(double value) {
+    if (!isfinite(value)) return 0;
+    double wrapped = fmod(trunc(value), 4294967296.0);
+    if (wrapped < 0) wrapped += 4294967296.0;
+    return (uint32_t) wrapped;
+}
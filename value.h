@@ -5,6 +5,7 @@
 #ifndef PANDA_VALUE_H
 #define PANDA_VALUE_H
 
+#include <math.h>
 #include <string.h>
 #include "common.h"
 //#include "object.h"
@@ -12,10 +13,95 @@
 typedef struct Obj Obj;
 typedef struct ObjString ObjString;
 
+#ifdef POINTER_COMPRESSION
+
+// 堆笼基址，所有对象都位于 [heapCage, heapCage + 4GB) 中
+extern char *heapCage;
+
+// 压缩后的对象引用：相对堆笼基址的 32 位偏移，0 表示 NULL
+#define REF(type)             uint32_t
+#define NULL_REF              ((uint32_t)0)
+#define TO_REF(pointer)       ((uint32_t)((pointer) == NULL ? 0 : (char*)(pointer) - heapCage))
+#define FROM_REF(type, ref)   ((type*)((ref) == 0 ? NULL : heapCage + (ref)))
+
+#else
+
+// 未开启指针压缩时，引用就是普通指针
+#define REF(type)             type *
+#define NULL_REF              NULL
+#define TO_REF(pointer)       (pointer)
+#define FROM_REF(type, ref)   (ref)
+
+#endif
+
+#ifdef NAN_BOXING
+
+// NaN boxing：所有 Value 都存放在一个 64 位整数中
+// 符号位，与 QNAN 一起用于标记对象指针
+#define SIGN_BIT ((uint64_t)0x8000000000000000)
+// 静默 NaN（多设置一位避开 Intel 的 QNaN Floating-Point Indefinite）
+#define QNAN     ((uint64_t)0x7ffc000000000000)
+
+// 单例值的标记位（存放在低 2 位中）
+#define TAG_NIL   1 // 01.
+#define TAG_FALSE 2 // 10.
+#define TAG_TRUE  3 // 11.
+// 小整数的标记位，整数本身存放在低 32 位中
+#define TAG_INT   ((uint64_t)0x0001000000000000)
+
+typedef uint64_t Value;
+
+#define FALSE_VAL         ((Value)(uint64_t)(QNAN | TAG_FALSE))
+#define TRUE_VAL          ((Value)(uint64_t)(QNAN | TAG_TRUE))
+
+// 判断当前值是否为 type
+#define IS_BOOL(value)    (((value) | 1) == TRUE_VAL)
+#define IS_NIL(value)     ((value) == NIL_VAL)
+#define IS_DOUBLE(value)  (((value) & QNAN) != QNAN)
+#define IS_INT(value)     (((value) & (SIGN_BIT | QNAN | TAG_INT)) == (QNAN | TAG_INT))
+#define IS_NUMBER(value)  (IS_DOUBLE(value) || IS_INT(value))
+#define IS_OBJ(value)     (((value) & (QNAN | SIGN_BIT)) == (QNAN | SIGN_BIT))
+
+// 将 panda 值转为 C 值
+#define AS_BOOL(value)    ((value) == TRUE_VAL)
+#define AS_INT(value)     ((int32_t)(uint32_t)(value))
+#define AS_NUMBER(value)  valueAsNumber(value)
+#define AS_OBJ(value)     ((Obj*)(uintptr_t)((value) & ~(SIGN_BIT | QNAN)))
+
+// 将原生的 C 语言值转为 panda 值
+#define BOOL_VAL(b)       ((b) ? TRUE_VAL : FALSE_VAL)
+#define NIL_VAL           ((Value)(uint64_t)(QNAN | TAG_NIL))
+#define NUMBER_VAL(num)   numToValue(num)
+#define INT_VAL(i)        ((Value)(QNAN | TAG_INT | (uint64_t)(uint32_t)(int32_t)(i)))
+#define OBJ_VAL(obj)      (Value)(SIGN_BIT | QNAN | (uint64_t)(uintptr_t)(obj))
+
+// 通过 memcpy 在 double 与 Value 之间转换位模式（编译器会优化为寄存器移动）
+static inline double valueToNum(Value value) {
+    double num;
+    memcpy(&num, &value, sizeof(Value));
+    return num;
+}
+
+// 载荷与标记位重合的 NaN（例如从字节数组中读出的任意位模式）换成标准的 NaN，
+// 否则脚本可以伪造小整数、单例值甚至对象指针；运算产生的 NaN 不会与标记位重合，保持原样
+static inline Value numToValue(double num) {
+    Value value;
+    memcpy(&value, &num, sizeof(double));
+    if ((value & QNAN) == QNAN) {
+        double nan = NAN;
+        memcpy(&value, &nan, sizeof(double));
+    }
+    return value;
+}
+
+#else
+
 typedef enum {
     VAL_BOOL,
     VAL_NIL,
     VAL_NUMBER,
+    // 小整数（与 VAL_NUMBER 对脚本透明）
+    VAL_INT,
     VAL_OBJ,
 } ValueType;
 
@@ -26,6 +112,7 @@ typedef struct {
     union {
         bool boolean;
         double number;
+        int32_t integer;
         Obj *obj;
     } as;
 } Value;
@@ -33,20 +120,34 @@ typedef struct {
 // 判断当前值是否为 type
 #define IS_BOOL(value)    ((value).type == VAL_BOOL)
 #define IS_NIL(value)     ((value).type == VAL_NIL)
-#define IS_NUMBER(value)  ((value).type == VAL_NUMBER)
+#define IS_DOUBLE(value)  ((value).type == VAL_NUMBER)
+#define IS_INT(value)     ((value).type == VAL_INT)
+#define IS_NUMBER(value)  (IS_DOUBLE(value) || IS_INT(value))
 #define IS_OBJ(value)     ((value).type == VAL_OBJ)
 
 // 将 panda 值转为 C 值
 #define AS_BOOL(value)    ((value).as.boolean)
-#define AS_NUMBER(value)  ((value).as.number)
+#define AS_INT(value)     ((value).as.integer)
+#define AS_NUMBER(value)  valueAsNumber(value)
 #define AS_OBJ(value)     ((value).as.obj)
 
 // 将原生的 C 语言值转为 panda 值
 #define BOOL_VAL(value)   ((Value){VAL_BOOL, {.boolean = value}})
 #define NIL_VAL           ((Value){VAL_NIL, {.number = 0}})
 #define NUMBER_VAL(value) ((Value){VAL_NUMBER, {.number = value}})
+#define INT_VAL(value)    ((Value){VAL_INT, {.integer = value}})
 #define OBJ_VAL(object)   ((Value){VAL_OBJ, {.obj = (Obj*)object}})
 
+#endif
+
+// 将数字（小整数或 double）统一转为 double
+static inline double valueAsNumber(Value value) {
+#ifdef NAN_BOXING
+    return IS_INT(value) ? (double) AS_INT(value) : valueToNum(value);
+#else
+    return IS_INT(value) ? (double) AS_INT(value) : value.as.number;
+#endif
+}
 
 // 常量池
 typedef struct {
@@ -65,4 +166,13 @@ void freeValueArray(ValueArray *array);
 
 void printValue(Value value);
 
+// formatNumber 所需的缓冲区大小
+#define NUMBER_BUFFER_SIZE 32
+
+// 将数字格式化为与 printValue 输出相同的文本，返回长度
+int formatNumber(Value value, char *buffer);
+
+// 取整后按 2^32 取模（与 JavaScript 的 ToUint32 相同），NaN 与无穷大为 0
+uint32_t numberToUint32(double value);
+
 #endif //PANDA_VALUE_H
@@ -12,11 +12,15 @@
 #include "memory.h"
 #include "compiler.h"
 #include "debug.h"
+#include "native.h"
+#include "map.h"
+#include "kernels.h"
 
 VM vm;
 
-static Value clockNative(int argCount, Value *args) {
-    return NUMBER_VAL((double) clock() / CLOCKS_PER_SEC);
+static bool clockNative(int argCount, Value *args) {
+    args[0] = NUMBER_VAL((double) clock() / CLOCKS_PER_SEC);
+    return true;
 }
 
 // 栈顶指针指向数组底
@@ -27,7 +31,7 @@ static void resetStack() {
 }
 
 
-static void runtimeError(const char *format, ...) {
+void runtimeError(const char *format, ...) {
     va_list args;
     va_start(args, format);
     vfprintf(stderr, format, args);
@@ -43,14 +47,15 @@ static void runtimeError(const char *format, ...) {
         if (function->name == NULL) {
             fprintf(stderr, "script\n");
         } else {
-            fprintf(stderr, "%s()\n", function->name->chars);
+            fprintf(stderr, "%.*s()\n", function->name->length, function->name->chars);
         }
     }
     resetStack();
 }
 
 static void defineNative(const char *name, NativeFn function) {
-    push(OBJ_VAL(copyString(name, (int) strlen(name))));
+    // 名称为静态数据，不需要拷贝
+    push(OBJ_VAL(externalString(name, (int) strlen(name), NULL)));
     push(OBJ_VAL(newNative(function)));
     tableSet(&vm.globals, AS_STRING(vm.stack[0]), vm.stack[1]);
     pop();
@@ -63,6 +68,9 @@ void initVM() {
     resetStack();
     // 对象链初试为空
     vm.objects = NULL;
+#ifdef POINTER_COMPRESSION
+    initHeapCage();
+#endif
     vm.bytesAllocated = 0;
     vm.nextGC = 1024 * 1024;
     vm.grayCount = 0;
@@ -70,19 +78,35 @@ void initVM() {
     vm.grayStack = NULL;
     initTable(&vm.globals);
     // 初始化 hash 表
-    initTable(&vm.strings);
+    initStringSet(&vm.strings);
     vm.initString = NULL;
-    vm.initString = copyString("init", 4);
+    vm.initString = externalString("init", 4, NULL);
+    initNativeMethods();
     defineNative("clock", clockNative);
+    defineNative("StringBuilder", stringBuilderNative);
+    initKernels();
+    defineNative("Float64Array", float64ArrayNative);
+    defineNative("Int32Array", int32ArrayNative);
+    defineNative("Uint8Array", uint8ArrayNative);
+    defineNative("Bytes", bytesNative);
+    defineNative("mapFile", mapFileNative);
+    defineNative("jsonParse", jsonParseNative);
+    defineNative("jsonStringify", jsonStringifyNative);
 }
 
 void freeVM() {
+#ifdef DEBUG_LOG_STRINGS
+    printTableStats(&vm.strings.slots, "strings");
+#endif
     // 释放 hash 表
-    freeTable(&vm.strings);
+    freeStringSet(&vm.strings);
     vm.initString = NULL;
     // 释放对象链
     freeObjects();
     freeTable(&vm.globals);
+#ifdef POINTER_COMPRESSION
+    freeHeapCage();
+#endif
 }
 
 // 获取当前的 Value ？？？？？？？？？
@@ -106,19 +130,32 @@ static bool call(ObjClosure *closure, int argCount) {
 }
 
 
+// 查找类的方法，自己的方法表中没有时沿父类链查找，找到后缓存到自己的方法表中
+// 类定义完成后方法不再变化，缓存不会过期，之后的查找只需要查一次表
+static bool findMethod(ObjClass *klass, ObjString *name, Value *method) {
+    if (tableGet(&klass->methods, name, method)) return true;
+    for (ObjClass *superclass = klass->superclass; superclass != NULL; superclass = superclass->superclass) {
+        if (tableGet(&superclass->methods, name, method)) {
+            tableSet(&klass->methods, name, *method);
+            return true;
+        }
+    }
+    return false;
+}
+
 static bool callValue(Value callee, int argCount) {
     if (IS_OBJ(callee)) {
         switch (OBJ_TYPE(callee)) {
             case OBJ_BOUND_METHOD: {
                 ObjBoundMethod *bound = AS_BOUND_METHOD(callee);
                 vm.stackTop[-argCount - 1] = bound->receiver;
-                return call(bound->method, argCount);
+                return call(BOUND_METHOD(bound), argCount);
             }
             case OBJ_CLASS: {
                 ObjClass *klass = AS_CLASS(callee);
                 vm.stackTop[-argCount - 1] = OBJ_VAL(newInstance(klass));
                 Value initializer;
-                if (tableGet(&klass->methods, vm.initString, &initializer)) {
+                if (findMethod(klass, vm.initString, &initializer)) {
                     return call(AS_CLOSURE(initializer), argCount);
                 } else if (argCount != 0) {
                     runtimeError("Expected 0 arguments but got %d.", argCount);
@@ -131,9 +168,8 @@ static bool callValue(Value callee, int argCount) {
                 return call(AS_CLOSURE(callee), argCount);
             case OBJ_NATIVE: {
                 NativeFn native = AS_NATIVE(callee);
-                Value result = native(argCount, vm.stackTop - argCount);
-                vm.stackTop -= argCount + 1;
-                push(result);
+                if (!native(argCount, vm.stackTop - argCount - 1)) return false;
+                vm.stackTop -= argCount;
                 return true;
             }
             default:
@@ -147,8 +183,8 @@ static bool callValue(Value callee, int argCount) {
 // 初始化器
 static bool invokeFromClass(ObjClass *klass, ObjString *name, int argCount) {
     Value method;
-    if (!tableGet(&klass->methods, name, &method)) {
-        runtimeError("Undefined property '%s'.", name->chars);
+    if (!findMethod(klass, name, &method)) {
+        runtimeError("Undefined property '%.*s'.", name->length, name->chars);
         return false;
     }
     return call(AS_CLOSURE(method), argCount);
@@ -157,6 +193,13 @@ static bool invokeFromClass(ObjClass *klass, ObjString *name, int argCount) {
 static bool invoke(ObjString *name, int argCount) {
     Value receiver = peek(argCount);
     if (!IS_INSTANCE(receiver)) {
+        // 内置类型的方法直接在栈上调用，结果留在接收者的位置
+        NativeMethod method = findNativeMethod(receiver, name);
+        if (method != NULL) {
+            if (!method(argCount, vm.stackTop - argCount - 1)) return false;
+            vm.stackTop -= argCount;
+            return true;
+        }
         runtimeError("Only instances have methods.(只有对象才有方法)");
         return false;
     }
@@ -166,13 +209,13 @@ static bool invoke(ObjString *name, int argCount) {
         vm.stackTop[-argCount - 1] = value;
         return callValue(value, argCount);
     }
-    return invokeFromClass(instance->klass, name, argCount);
+    return invokeFromClass(INSTANCE_CLASS(instance), name, argCount);
 }
 
 static bool bindMethod(ObjClass *klass, ObjString *name) {
     Value method;
-    if (!tableGet(&klass->methods, name, &method)) {
-        runtimeError("Undefined property '%s'.", name->chars);
+    if (!findMethod(klass, name, &method)) {
+        runtimeError("Undefined property '%.*s'.", name->length, name->chars);
         return false;
     }
     //
@@ -224,36 +267,245 @@ static void defineMethod(ObjString *name) {
     pop();
 }
 
+// 检查列表（数组）下标：必须是 [0, length) 中的整数
+static bool arrayIndex(int length, Value index, int *result) {
+    if (!IS_NUMBER(index)) {
+        runtimeError("Index must be a number.");
+        return false;
+    }
+    double number = AS_NUMBER(index);
+    // 先确认在范围内再转换，NaN 和超出 int 的值直接转换是未定义行为
+    if (!(number >= 0 && number < length) || number != (int) number) {
+        runtimeError("Index out of range.");
+        return false;
+    }
+    *result = (int) number;
+    return true;
+}
+
+// for-in 循环取下一个元素：iterator[0] 为集合，iterator[1] 为下一个下标，元素存入 iterator[2]
+// 集合遍历完时 *more 为 false；列表每次都重新读取长度，循环中追加的元素也会被遍历；映射遍历键
+static bool iterate(Value *iterator, bool *more) {
+    Value sequence = iterator[0];
+    int index = AS_INT(iterator[1]);
+    *more = false;
+    if (IS_LIST(sequence)) {
+        ObjList *list = AS_LIST(sequence);
+        if (index >= list->items.count) return true;
+        iterator[2] = list->items.values[index];
+    } else if (IS_MAP(sequence)) {
+        ObjMap *map = AS_MAP(sequence);
+        // 跳过已删除的键值对
+        while (index < map->entryCount && IS_NIL(map->entries[index].key)) index++;
+        if (index >= map->entryCount) return true;
+        iterator[2] = map->entries[index].key;
+    } else if (IS_ANY_STRING(sequence)) {
+        ObjString *string = IS_ROPE(sequence) ? flattenRope(AS_ROPE(sequence)) : AS_STRING(sequence);
+        if (index >= string->length) return true;
+        // 单个字符的字符串已经驻留，只有第一次需要分配
+        iterator[2] = OBJ_VAL(copyString(string->chars + index, 1));
+    } else if (IS_TYPED_ARRAY(sequence)) {
+        ObjTypedArray *array = AS_TYPED_ARRAY(sequence);
+        if (index >= array->length) return true;
+        iterator[2] = typedArrayGet(array, index);
+    } else if (IS_BYTES(sequence)) {
+        ObjBytes *bytes = AS_BYTES(sequence);
+        if (index >= bytes->length) return true;
+        iterator[2] = INT_VAL(bytes->data[index]);
+    } else {
+        runtimeError("Can only iterate over lists, maps, strings, typed arrays and bytes.");
+        return false;
+    }
+    iterator[1] = INT_VAL(index + 1);
+    *more = true;
+    return true;
+}
+
 // 判断该 value 是否为 nil 或者 false，返回 bool
 static bool isFalsey(Value value) {
     return IS_NIL(value) || (IS_BOOL(value) && !AS_BOOL(value));
 }
 
+// 拼接结果达到该长度时使用拼接节点
+#define ROPE_MIN_LENGTH 64
+
+// 返回字符串或拼接节点的长度
+static int anyStringLength(Value value) {
+    return IS_ROPE(value) ? AS_ROPE(value)->length : AS_STRING(value)->length;
+}
+
 // 连接函数，连接两个字符串
 static void concatenate() {
-    // 从栈顶弹出 2 个值
-//    ObjString *b = AS_STRING(pop());
-//    ObjString *a = AS_STRING(pop());
+    // 计算总长度
+    int length = anyStringLength(peek(0)) + anyStringLength(peek(1));
+    // 较长的结果只创建拼接节点，不拷贝字符（拼接节点的长度都不小于 ROPE_MIN_LENGTH）
+    if (length >= ROPE_MIN_LENGTH) {
+        ObjRope *rope = newRope(AS_OBJ(peek(1)), AS_OBJ(peek(0)), length);
+        pop();
+        pop();
+        push(OBJ_VAL(rope));
+        return;
+    }
+    // 从栈顶取出 2 个值（仍留在栈上，分配内存时 GC 可以找到它们）
     ObjString *b = AS_STRING(peek(0));
     ObjString *a = AS_STRING(peek(1));
-    // 计算总长度
-    int length = a->length + b->length;
-    // 重新分配内存
-    char *chars = ALLOCATE(char, length + 1);
+    // 直接在新的字符串对象中拼接
+    ObjString *result = newString(length);
     // 拷贝值
-    memcpy(chars, a->chars, a->length);
-    memcpy(chars + a->length, b->chars, b->length);
-    chars[length] = '\0';
-    // 获取新的 string 对象
-    ObjString *result = takeString(chars, length);
+    memcpy(result->chars, a->chars, a->length);
+    memcpy(result->chars + a->length, b->chars, b->length);
+    // 运行时拼接的字符串不计算哈希也不驻留，用作表的键时才驻留
     pop();
     pop();
     // 将新的 C字符串转为 panda 值
     push(OBJ_VAL(result));
 }
 
+// 小整数乘法：溢出或结果应为 -0（0 与负数相乘）时返回 true，调用方改用 double 运算
+static inline bool intMultiplyOverflow(int32_t a, int32_t b, int32_t *result) {
+    if (__builtin_mul_overflow(a, b, result)) return true;
+    return *result == 0 && (a < 0 || b < 0);
+}
+
+// OP_ADD、OP_SUBTRACT、OP_MULTIPLY、OP_DIVIDE 的运算，算术指令与复合赋值共用，结果压入栈中
+// 两个操作数都是小整数时做带溢出检查的整数运算，溢出则提升为 double
+// 拼接字符串会分配内存，a 与 b 需要能被 GC 找到
+static inline bool arithmetic(uint8_t op, Value a, Value b) {
+    if (IS_INT(a) && IS_INT(b) && op != OP_DIVIDE) {
+        int32_t x = AS_INT(a);
+        int32_t y = AS_INT(b);
+        int32_t result;
+        bool overflow;
+        double wide;
+        switch (op) {
+            case OP_ADD:
+                overflow = __builtin_add_overflow(x, y, &result);
+                wide = (double) x + (double) y;
+                break;
+            case OP_SUBTRACT:
+                overflow = __builtin_sub_overflow(x, y, &result);
+                wide = (double) x - (double) y;
+                break;
+            default:
+                overflow = intMultiplyOverflow(x, y, &result);
+                wide = (double) x * (double) y;
+                break;
+        }
+        push(overflow ? NUMBER_VAL(wide) : INT_VAL(result));
+        return true;
+    }
+    if (IS_NUMBER(a) && IS_NUMBER(b)) {
+        double x = AS_NUMBER(a);
+        double y = AS_NUMBER(b);
+        switch (op) {
+            case OP_ADD:
+                push(NUMBER_VAL(x + y));
+                break;
+            case OP_SUBTRACT:
+                push(NUMBER_VAL(x - y));
+                break;
+            case OP_MULTIPLY:
+                push(NUMBER_VAL(x * y));
+                break;
+            default:
+                push(NUMBER_VAL(x / y));
+                break;
+        }
+        return true;
+    }
+    if (op == OP_ADD && IS_ANY_STRING(a) && IS_ANY_STRING(b)) {
+        push(a);
+        push(b);
+        concatenate();
+        return true;
+    }
+    if (op == OP_ADD) {
+        runtimeError("Operands must be two numbers or two strings.");
+    } else {
+        runtimeError("Operands must be numbers.（比较的值必须是数字）");
+    }
+    return false;
+}
+
+// 自增自减：原地更新 target，压入原来的值
+// 只有数字能自增，运算不会分配内存，target 可以指向表中的值
+static inline bool increment(Value *target, int8_t delta) {
+    Value old = *target;
+    int32_t result;
+    if (IS_INT(old) && !__builtin_add_overflow(AS_INT(old), delta, &result)) {
+        *target = INT_VAL(result);
+    } else if (IS_NUMBER(old)) {
+        *target = NUMBER_VAL(AS_NUMBER(old) + delta);
+    } else {
+        runtimeError("Operand must be a number.(操作数必须是一个数字)");
+        return false;
+    }
+    push(old);
+    return true;
+}
+
+// 复合赋值：target 与栈顶的右值运算后原地更新，右值换成新值
+// 运算期间只有字符串拼接会分配内存，GC 不会修改变量槽位和实例、全局变量的表，target 仍然有效
+static inline bool compound(Value *target, uint8_t op) {
+    if (!arithmetic(op, *target, peek(0))) return false;
+    Value value = pop();
+    *target = value;
+    vm.stackTop[-1] = value;
+    return true;
+}
+
+// 复合赋值与自增自减的下标目标：读出 container[key]，检查与 OP_INDEX_GET 相同
+static bool indexLoad(Value container, Value key, Value *value) {
+    int index;
+    if (IS_BYTES(container)) {
+        ObjBytes *bytes = AS_BYTES(container);
+        if (!arrayIndex(bytes->length, key, &index)) return false;
+        *value = INT_VAL(bytes->data[index]);
+    } else if (IS_TYPED_ARRAY(container)) {
+        ObjTypedArray *array = AS_TYPED_ARRAY(container);
+        if (!arrayIndex(array->length, key, &index)) return false;
+        *value = typedArrayGet(array, index);
+    } else if (IS_MAP(container)) {
+        if (!mapGet(AS_MAP(container), key, value)) *value = NIL_VAL;
+    } else if (IS_LIST(container)) {
+        ObjList *list = AS_LIST(container);
+        if (!arrayIndex(list->items.count, key, &index)) return false;
+        *value = list->items.values[index];
+    } else {
+        runtimeError("Only lists and maps can be indexed.");
+        return false;
+    }
+    return true;
+}
+
+// 写回 container[key]，下标已经由 indexLoad 检查过，检查与 OP_INDEX_SET 相同
+static bool indexStore(Value container, Value key, Value value) {
+    int index;
+    if (IS_BYTES(container)) {
+        ObjBytes *bytes = AS_BYTES(container);
+        if (!arrayIndex(bytes->length, key, &index)) return false;
+        bytes->data[index] = (uint8_t) numberToUint32(AS_NUMBER(value));
+    } else if (IS_TYPED_ARRAY(container)) {
+        ObjTypedArray *array = AS_TYPED_ARRAY(container);
+        if (!arrayIndex(array->length, key, &index)) return false;
+        typedArraySet(array, index, AS_NUMBER(value));
+    } else if (IS_MAP(container)) {
+        if (IS_NIL(key)) {
+            runtimeError("Map key cannot be nil.");
+            return false;
+        }
+        mapSet(AS_MAP(container), key, value);
+    } else {
+        ObjList *list = AS_LIST(container);
+        if (!arrayIndex(list->items.count, key, &index)) return false;
+        list->items.values[index] = value;
+    }
+    return true;
+}
+
 // 运行指令集，返回解释结果
-static InterpretResult run() {
+// 帧数回到 baseFrame 时返回：0 表示运行整个脚本，否则是从原生函数中重入
+static InterpretResult run(int baseFrame) {
     CallFrame *frame = &vm.frames[vm.frameCount - 1];
 // 返回当前chunk 值，并将指针后移一位
 #define READ_BYTE() (*frame->ip++)
@@ -276,6 +528,17 @@ static InterpretResult run() {
       double a = AS_NUMBER(pop()); \
       push(valueType(a op b)); \
     } while (false)
+// 比较指令宏，两个操作数都是小整数时直接比较整数
+#define COMPARE_OP(op) \
+    do { \
+      if (IS_INT(peek(0)) && IS_INT(peek(1))) { \
+        int32_t b = AS_INT(pop()); \
+        int32_t a = AS_INT(pop()); \
+        push(BOOL_VAL(a op b)); \
+      } else { \
+        BINARY_OP(BOOL_VAL, op); \
+      } \
+    } while (false)
 
     for (;;) {
 //        如果是调试模式，则输出 chunk 中的各种信息
@@ -342,7 +605,7 @@ static InterpretResult run() {
                 ObjString *name = READ_STRING();
                 Value value;
                 if (!tableGet(&vm.globals, name, &value)) {
-                    runtimeError("Undefined variable '%s'.（没有定义该全局变量）", name->chars);
+                    runtimeError("Undefined variable '%.*s'.（没有定义该全局变量）", name->length, name->chars);
                     return INTERPRET_RUNTIME_ERROR;
                 }
                 push(value);
@@ -362,19 +625,19 @@ static InterpretResult run() {
                 ObjString *name = READ_STRING();
                 if (tableSet(&vm.globals, name, peek(0))) {
                     tableDelete(&vm.globals, name);
-                    runtimeError("Undefined variable '%s'.（没有定义该全局变量）", name->chars);
+                    runtimeError("Undefined variable '%.*s'.（没有定义该全局变量）", name->length, name->chars);
                     return INTERPRET_RUNTIME_ERROR;
                 }
                 break;
             }
             case OP_GET_UPVALUE: {
                 uint8_t slot = READ_BYTE();
-                push(*frame->closure->upvalues[slot]->location);
+                push(*CLOSURE_UPVALUE(frame->closure, slot)->location);
                 break;
             }
             case OP_SET_UPVALUE: {
                 uint8_t slot = READ_BYTE();
-                *frame->closure->upvalues[slot]->location = peek(0);
+                *CLOSURE_UPVALUE(frame->closure, slot)->location = peek(0);
                 break;
             }
             case OP_GET_PROPERTY: {
@@ -391,7 +654,7 @@ static InterpretResult run() {
                     push(value);
                     break;
                 }
-                if (!bindMethod(instance->klass, name)) {
+                if (!bindMethod(INSTANCE_CLASS(instance), name)) {
                     return INTERPRET_RUNTIME_ERROR;
                 }
                 break;
@@ -418,43 +681,29 @@ static InterpretResult run() {
                 break;
             }
             case OP_EQUAL: {
-                Value b = pop();
-                Value a = pop();
-                push(BOOL_VAL(valuesEqual(a, b)));
+                // 比较拼接节点时可能需要分配内存，比较完再出栈
+                bool equal = valuesEqual(peek(1), peek(0));
+                pop();
+                pop();
+                push(BOOL_VAL(equal));
                 break;
             }
             case OP_GREATER: {
-                BINARY_OP(BOOL_VAL, >);
+                COMPARE_OP(>);
                 break;
             }
             case OP_LESS: {
-                BINARY_OP(BOOL_VAL, <);
-                break;
-            }
-            case OP_ADD: {
-                if (IS_STRING(peek(0)) && IS_STRING(peek(1))) {
-                    concatenate();
-                } else if (IS_NUMBER(peek(0)) && IS_NUMBER(peek(1))) {
-                    double b = AS_NUMBER(pop());
-                    double a = AS_NUMBER(pop());
-                    push(NUMBER_VAL(a + b));
-                } else {
-                    runtimeError(
-                            "Operands must be two numbers or two strings.");
-                    return INTERPRET_RUNTIME_ERROR;
-                }
-                break;
-            }
-            case OP_SUBTRACT: {
-                BINARY_OP(NUMBER_VAL, -);
-                break;
-            }
-            case OP_MULTIPLY: {
-                BINARY_OP(NUMBER_VAL, *);
+                COMPARE_OP(<);
                 break;
             }
+            case OP_ADD:
+            case OP_SUBTRACT:
+            case OP_MULTIPLY:
             case OP_DIVIDE: {
-                BINARY_OP(NUMBER_VAL, /);
+                // 结果压在两个操作数之上，再移到左操作数的位置；拼接字符串期间操作数仍在栈上
+                if (!arithmetic(instruction, peek(1), peek(0))) return INTERPRET_RUNTIME_ERROR;
+                vm.stackTop[-3] = vm.stackTop[-1];
+                vm.stackTop -= 2;
                 break;
             }
             case OP_NOT: {
@@ -467,6 +716,11 @@ static InterpretResult run() {
 //                    runtimeError("操作数必须是一个数字。");
                     return INTERPRET_RUNTIME_ERROR;
                 }
+                // 0 取反得到 -0，INT32_MIN 取反会溢出，这两种情况仍使用 double
+                if (IS_INT(peek(0)) && AS_INT(peek(0)) != 0 && AS_INT(peek(0)) != INT32_MIN) {
+                    push(INT_VAL(-AS_INT(pop())));
+                    break;
+                }
                 push(NUMBER_VAL(-AS_NUMBER(pop())));
                 break;
             }
@@ -522,6 +776,267 @@ static InterpretResult run() {
                 }
                 frame = &vm.frames[vm.frameCount - 1];
                 break;
+            }
+            case OP_BUILD_LIST: {
+                int count = READ_BYTE();
+                // 元素在复制到列表前一直留在栈上
+                ObjList *list = newList(count);
+                if (count > 0) memcpy(list->items.values, vm.stackTop - count, sizeof(Value) * count);
+                list->items.count = count;
+                vm.stackTop -= count;
+                push(OBJ_VAL(list));
+                break;
+            }
+            case OP_BUILD_MAP: {
+                int count = READ_BYTE();
+                // 插入时可能触发 GC，映射与键值都留在栈上，全部插入后再出栈
+                ObjMap *map = newMap();
+                push(OBJ_VAL(map));
+                Value *pairs = vm.stackTop - 1 - count * 2;
+                for (int i = 0; i < count; i++) {
+                    if (IS_NIL(pairs[i * 2])) {
+                        runtimeError("Map key cannot be nil.");
+                        return INTERPRET_RUNTIME_ERROR;
+                    }
+                    mapSet(map, pairs[i * 2], pairs[i * 2 + 1]);
+                }
+                vm.stackTop = pairs;
+                push(OBJ_VAL(map));
+                break;
+            }
+            case OP_INDEX_GET: {
+                if (IS_BYTES(peek(1))) {
+                    ObjBytes *bytes = AS_BYTES(peek(1));
+                    int index;
+                    if (!arrayIndex(bytes->length, peek(0), &index)) return INTERPRET_RUNTIME_ERROR;
+                    vm.stackTop -= 2;
+                    push(INT_VAL(bytes->data[index]));
+                    break;
+                }
+                if (IS_TYPED_ARRAY(peek(1))) {
+                    ObjTypedArray *array = AS_TYPED_ARRAY(peek(1));
+                    int index;
+                    if (!arrayIndex(array->length, peek(0), &index)) return INTERPRET_RUNTIME_ERROR;
+                    vm.stackTop -= 2;
+                    push(typedArrayGet(array, index));
+                    break;
+                }
+                if (IS_MAP(peek(1))) {
+                    // 不存在的键读出 nil
+                    Value value;
+                    if (!mapGet(AS_MAP(peek(1)), peek(0), &value)) value = NIL_VAL;
+                    vm.stackTop -= 2;
+                    push(value);
+                    break;
+                }
+                if (!IS_LIST(peek(1))) {
+                    runtimeError("Only lists and maps can be indexed.");
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                ObjList *list = AS_LIST(peek(1));
+                int index;
+                if (!arrayIndex(list->items.count, peek(0), &index)) return INTERPRET_RUNTIME_ERROR;
+                vm.stackTop -= 2;
+                push(list->items.values[index]);
+                break;
+            }
+            case OP_INDEX_SET: {
+                if (IS_BYTES(peek(2))) {
+                    ObjBytes *bytes = AS_BYTES(peek(2));
+                    int index;
+                    if (!arrayIndex(bytes->length, peek(1), &index)) return INTERPRET_RUNTIME_ERROR;
+                    if (!IS_NUMBER(peek(0))) {
+                        runtimeError("Bytes can only hold numbers.");
+                        return INTERPRET_RUNTIME_ERROR;
+                    }
+                    bytes->data[index] = (uint8_t) numberToUint32(AS_NUMBER(peek(0)));
+                    Value value = pop();
+                    vm.stackTop -= 2;
+                    push(value);
+                    break;
+                }
+                if (IS_TYPED_ARRAY(peek(2))) {
+                    ObjTypedArray *array = AS_TYPED_ARRAY(peek(2));
+                    int index;
+                    if (!arrayIndex(array->length, peek(1), &index)) return INTERPRET_RUNTIME_ERROR;
+                    if (!IS_NUMBER(peek(0))) {
+                        runtimeError("Typed array elements must be numbers.");
+                        return INTERPRET_RUNTIME_ERROR;
+                    }
+                    typedArraySet(array, index, AS_NUMBER(peek(0)));
+                    Value value = pop();
+                    vm.stackTop -= 2;
+                    push(value);
+                    break;
+                }
+                if (IS_MAP(peek(2))) {
+                    if (IS_NIL(peek(1))) {
+                        runtimeError("Map key cannot be nil.");
+                        return INTERPRET_RUNTIME_ERROR;
+                    }
+                    mapSet(AS_MAP(peek(2)), peek(1), peek(0));
+                    Value value = pop();
+                    vm.stackTop -= 2;
+                    push(value);
+                    break;
+                }
+                if (!IS_LIST(peek(2))) {
+                    runtimeError("Only lists and maps can be indexed.");
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                ObjList *list = AS_LIST(peek(2));
+                int index;
+                if (!arrayIndex(list->items.count, peek(1), &index)) return INTERPRET_RUNTIME_ERROR;
+                Value value = pop();
+                list->items.values[index] = value;
+                vm.stackTop -= 2;
+                push(value);
+                break;
+            }
+            case OP_FOR_PREP: {
+                Value *range = &frame->slots[READ_BYTE()];
+                uint16_t offset = READ_SHORT();
+                if (!IS_NUMBER(range[0]) || !IS_NUMBER(range[1])) {
+                    runtimeError("Range bounds must be numbers.");
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                bool empty = IS_INT(range[0]) && IS_INT(range[1]) ? AS_INT(range[0]) >= AS_INT(range[1])
+                                                                  : !(AS_NUMBER(range[0]) < AS_NUMBER(range[1]));
+                if (empty) {
+                    frame->ip += offset;
+                } else {
+                    range[2] = range[0];
+                }
+                break;
+            }
+            case OP_FOR_RANGE: {
+                Value *range = &frame->slots[READ_BYTE()];
+                uint16_t offset = READ_SHORT();
+                // 计数器小于终点，两者都是小整数时加一不会溢出
+                if (IS_INT(range[0]) && IS_INT(range[1])) {
+                    int32_t next = AS_INT(range[0]) + 1;
+                    if (next < AS_INT(range[1])) {
+                        range[0] = range[2] = INT_VAL(next);
+                        frame->ip -= offset;
+                    }
+                } else {
+                    Value next = IS_INT(range[0]) && AS_INT(range[0]) < INT32_MAX ? INT_VAL(AS_INT(range[0]) + 1)
+                                                                                  : NUMBER_VAL(AS_NUMBER(range[0]) + 1);
+                    if (AS_NUMBER(next) < AS_NUMBER(range[1])) {
+                        range[0] = range[2] = next;
+                        frame->ip -= offset;
+                    }
+                }
+                break;
+            }
+            case OP_FOR_ITER: {
+                Value *iterator = &frame->slots[READ_BYTE()];
+                uint16_t offset = READ_SHORT();
+                bool more;
+                if (!iterate(iterator, &more)) return INTERPRET_RUNTIME_ERROR;
+                if (more) frame->ip -= offset;
+                break;
+            }
+            case OP_INC_LOCAL: {
+                Value *target = &frame->slots[READ_BYTE()];
+                if (!increment(target, (int8_t) READ_BYTE())) return INTERPRET_RUNTIME_ERROR;
+                break;
+            }
+            case OP_INC_UPVALUE: {
+                uint8_t slot = READ_BYTE();
+                Value *target = CLOSURE_UPVALUE(frame->closure, slot)->location;
+                if (!increment(target, (int8_t) READ_BYTE())) return INTERPRET_RUNTIME_ERROR;
+                break;
+            }
+            case OP_INC_GLOBAL: {
+                ObjString *name = READ_STRING();
+                Value *target = tableGetSlot(&vm.globals, name);
+                if (target == NULL) {
+                    runtimeError("Undefined variable '%.*s'.（没有定义该全局变量）", name->length, name->chars);
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                if (!increment(target, (int8_t) READ_BYTE())) return INTERPRET_RUNTIME_ERROR;
+                break;
+            }
+            case OP_INC_PROPERTY: {
+                ObjString *name = READ_STRING();
+                int8_t delta = (int8_t) READ_BYTE();
+                if (!IS_INSTANCE(peek(0))) {
+                    runtimeError("Only instances have fields.");
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                Value *target = tableGetSlot(&AS_INSTANCE(peek(0))->fields, name);
+                if (target == NULL) {
+                    runtimeError("Undefined property '%.*s'.", name->length, name->chars);
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                if (!increment(target, delta)) return INTERPRET_RUNTIME_ERROR;
+                // 原来的值替换实例
+                Value old = pop();
+                vm.stackTop[-1] = old;
+                break;
+            }
+            case OP_INC_INDEX: {
+                int8_t delta = (int8_t) READ_BYTE();
+                Value value;
+                if (!indexLoad(peek(1), peek(0), &value)) return INTERPRET_RUNTIME_ERROR;
+                if (!increment(&value, delta)) return INTERPRET_RUNTIME_ERROR;
+                if (!indexStore(peek(2), peek(1), value)) return INTERPRET_RUNTIME_ERROR;
+                Value old = pop();
+                vm.stackTop -= 2;
+                push(old);
+                break;
+            }
+            case OP_COMPOUND_LOCAL: {
+                Value *target = &frame->slots[READ_BYTE()];
+                if (!compound(target, READ_BYTE())) return INTERPRET_RUNTIME_ERROR;
+                break;
+            }
+            case OP_COMPOUND_UPVALUE: {
+                uint8_t slot = READ_BYTE();
+                Value *target = CLOSURE_UPVALUE(frame->closure, slot)->location;
+                if (!compound(target, READ_BYTE())) return INTERPRET_RUNTIME_ERROR;
+                break;
+            }
+            case OP_COMPOUND_GLOBAL: {
+                ObjString *name = READ_STRING();
+                Value *target = tableGetSlot(&vm.globals, name);
+                if (target == NULL) {
+                    runtimeError("Undefined variable '%.*s'.（没有定义该全局变量）", name->length, name->chars);
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                if (!compound(target, READ_BYTE())) return INTERPRET_RUNTIME_ERROR;
+                break;
+            }
+            case OP_COMPOUND_PROPERTY: {
+                ObjString *name = READ_STRING();
+                uint8_t op = READ_BYTE();
+                if (!IS_INSTANCE(peek(1))) {
+                    runtimeError("Only instances have fields.");
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                Value *target = tableGetSlot(&AS_INSTANCE(peek(1))->fields, name);
+                if (target == NULL) {
+                    runtimeError("Undefined property '%.*s'.", name->length, name->chars);
+                    return INTERPRET_RUNTIME_ERROR;
+                }
+                if (!compound(target, op)) return INTERPRET_RUNTIME_ERROR;
+                // 新值替换实例
+                Value value = pop();
+                vm.stackTop[-1] = value;
+                break;
+            }
+            case OP_COMPOUND_INDEX: {
+                uint8_t op = READ_BYTE();
+                Value old;
+                if (!indexLoad(peek(2), peek(1), &old)) return INTERPRET_RUNTIME_ERROR;
+                push(old);
+                if (!arithmetic(op, old, peek(1))) return INTERPRET_RUNTIME_ERROR;
+                if (!indexStore(peek(4), peek(3), peek(0))) return INTERPRET_RUNTIME_ERROR;
+                Value value = pop();
+                vm.stackTop -= 4;
+                push(value);
+                break;
             }
                 // 闭包的解释过程
             case OP_CLOSURE: {
@@ -535,7 +1050,7 @@ static InterpretResult run() {
                     uint8_t isLocal = READ_BYTE();
                     uint8_t index = READ_BYTE();
                     if (isLocal) {
-                        closure->upvalues[i] = captureUpvalue(frame->slots + index);
+                        closure->upvalues[i] = TO_REF(captureUpvalue(frame->slots + index));
                     } else {
                         closure->upvalues[i] = frame->closure->upvalues[index];
                     }
@@ -561,8 +1076,7 @@ static InterpretResult run() {
                     return INTERPRET_RUNTIME_ERROR;
                 }
                 ObjClass *subclass = AS_CLASS(peek(0));
-                tableAddAll(&AS_CLASS(superclass)->methods,
-                            &subclass->methods);
+                subclass->superclass = AS_CLASS(superclass);
                 pop(); // Subclass.
                 break;
             }
@@ -578,9 +1092,10 @@ static InterpretResult run() {
                 // 函数减一
                 vm.frameCount--;
 
-                // 如果函数减完了，说明程序结束
-                if (vm.frameCount == 0) {
-                    pop();
+                // 如果函数减完了，说明程序结束；重入时返回值留给调用的原生函数
+                if (vm.frameCount == baseFrame) {
+                    vm.stackTop = frame->slots;
+                    if (baseFrame > 0) push(result);
                     return INTERPRET_OK;
                 }
 
@@ -597,15 +1112,13 @@ static InterpretResult run() {
 #undef READ_BYTE
 #undef READ_CONSTANT
 #undef BINARY_OP
+#undef COMPARE_OP
 #undef READ_STRING
 #undef READ_SHORT
 }
 
-// 启动解释器
-InterpretResult interpret(const char *source) {
-    // 编译该文件，并返回编译完后的函数对象
-    ObjFunction *function = compile(source);
-//    exit(0);
+// 运行编译完后的函数对象
+static InterpretResult interpretFunction(ObjFunction *function) {
     if (function == NULL)
         return INTERPRET_COMPILE_ERROR;
     push(OBJ_VAL(function));
@@ -613,11 +1126,29 @@ InterpretResult interpret(const char *source) {
     pop();
     push(OBJ_VAL(closure));
     call(closure, 0);
-    return run();
+    return run(0);
+}
+
+bool callFromNative(int argCount) {
+    int baseFrame = vm.frameCount;
+    if (!callValue(vm.stackTop[-argCount - 1], argCount)) return false;
+    // 原生函数和没有初始化器的类不压入新的帧，已经完成调用
+    if (vm.frameCount == baseFrame) return true;
+    return run(baseFrame) == INTERPRET_OK;
+}
+
+// 启动解释器
+InterpretResult interpret(const char *source) {
+    // 编译该文件，并返回编译完后的函数对象
+    return interpretFunction(compile(source, NULL));
+}
+
+// 解释由 GC 字符串持有的源码，字面量和标识符直接引用源码中的字符
+InterpretResult interpretSource(ObjString *source) {
+    return interpretFunction(compile(source->chars, (Obj *) source));
 }
 
 void push(Value value) {
-    printf("%d", vm.stackTop->type);
     *vm.stackTop = value;
     vm.stackTop++;
 }
@@ -625,4 +1156,4 @@ void push(Value value) {
 Value pop() {
     vm.stackTop--;
     return *vm.stackTop;
-}
\ No newline at end of file
+}
@@ -38,8 +38,8 @@ typedef struct {
     Value *stackTop;
     // 全局变量 hash 表
     Table globals;
-    // 字符串 hash 表
-    Table strings;
+    // 驻留字符串集合
+    StringSet strings;
     ObjString* initString;
     //
     ObjUpvalue *openUpvalues;
@@ -73,6 +73,15 @@ void freeVM();
 
 InterpretResult interpret(const char *source);
 
+InterpretResult interpretSource(ObjString *source);
+
+
+// 报告运行时错误并重置栈
+void runtimeError(const char *format, ...);
+
+// 在原生函数中调用脚本函数：被调用者和 argCount 个参数已经压栈，
+// 成功时返回值留在被调用者的位置；失败时已经报告运行时错误（栈已重置）
+bool callFromNative(int argCount);
 
 void push(Value value);
 